@@ -6,11 +6,17 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#ifdef HAVE_UNISTD_H
+  #include <unistd.h>
+#endif
 
-/* Private data used by writer */
+/* Private data used by reader & writer */
 typedef struct{
   uint32_t nsamples;
-  FILE * ch[4];
+  FILE * ch[4];           /* Reader: one stream per channel */
+  size_t region;          /* Writer: bytes reserved per channel, or 0 */
+  size_t written;         /* Writer: bytes written per channel */
+  lsx_tmpbuf_t tmp[4];    /* Writer: channel data not yet in place */
 } priv_t;
 
 static void svxwriteheader(sox_format_t *, size_t);
@@ -226,24 +232,22 @@ static int stopread(sox_format_t * ft)
 /*======================================================================*/
 /*                         8SVXSTARTWRITE                               */
 /*======================================================================*/
+#define SVXHEADERSIZE 100
 static int startwrite(sox_format_t * ft)
 {
         priv_t * p = (priv_t * ) ft->priv;
-        size_t i;
-
-        /* open channel output files */
-        p->ch[0] = ft->fp;
-        for (i = 1; i < ft->signal.channels; i++) {
-                if ((p->ch[i] = lsx_tmpfile()) == NULL)
-                {
-                        lsx_fail_errno(ft,errno,"Can't open channel output file");
-                        return(SOX_EOF);
-                }
-        }
 
         /* write header (channel 0) */
         p->nsamples = 0;
         svxwriteheader(ft, (size_t) p->nsamples);
+
+        /* If the length is known and the output seekable, reserve a region
+         * of the BODY for each channel and write the channels in place;
+         * otherwise, channels 1.. are held in temporary buffers until the
+         * end.  Both ways, stopwrite fixes up any length mis-estimate. */
+        if (ft->seekable && ft->signal.channels > 1 &&
+            ft->signal.length && ft->signal.length != SOX_IGNORE_LENGTH)
+                p->region = min(ft->signal.length, 0xffffff00u) / ft->signal.channels;
         return(SOX_SUCCESS);
 }
 
@@ -256,55 +260,143 @@ static size_t write_samples(sox_format_t * ft, const sox_sample_t *buf, size_t l
         priv_t * p = (priv_t * ) ft->priv;
         SOX_SAMPLE_LOCALS;
 
-        unsigned char datum;
-        size_t done = 0, i;
-
-        p->nsamples += len;
-
-        while(done < len) {
-                for (i = 0; i < ft->signal.channels; i++) {
-                        datum = SOX_SAMPLE_TO_SIGNED_8BIT(*buf++, ft->clips);
-                        /* FIXME: Needs to pass ft struct and not FILE */
-                        putc(datum, p->ch[i]);
+        size_t chans = ft->signal.channels, n = len / chans, i, j, m;
+        signed char * data = lsx_malloc(len + !len);
+
+        /* de-interleave, channel by channel */
+        for (j = 0; j < n; ++j)
+                for (i = 0; i < chans; ++i)
+                        data[i * n + j] = SOX_SAMPLE_TO_SIGNED_8BIT(*buf++, ft->clips);
+
+        for (i = 0; i < chans; ++i) {
+                signed char const * d = data + i * n;
+                m = n;
+                if (p->region) {  /* in-place, up to the end of the region */
+                        m = p->written < p->region? min(n, p->region - p->written) : 0;
+                        if (m && (lsx_seeki(ft, (off_t)(SVXHEADERSIZE + i * p->region + p->written), SEEK_SET) ||
+                                lsx_writebuf(ft, d, m) != m))
+                                break;
+                        d += m;
+                        m = n - m;
+                }
+                else if (i == 0) {
+                        if (lsx_writebuf(ft, d, m) != m)
+                                break;
+                        continue;
+                }
+                if (m && lsx_tmpbuf_write(&p->tmp[i], d, m) != SOX_SUCCESS) {
+                        lsx_fail_errno(ft, errno, "Can't write channel %lu temporary data", (unsigned long)i);
+                        break;
                 }
-                done += ft->signal.channels;
         }
-        return (done);
+        free(data);
+        if (i < chans)
+                return 0;
+        p->written += n;
+        p->nsamples += n * chans;
+        return n * chans;
 }
 
 /*======================================================================*/
 /*                         8SVXSTOPWRITE                                */
 /*======================================================================*/
 
+/* Moves len bytes within the output file; the ranges may overlap */
+static int move_data(sox_format_t * ft, off_t from, off_t to, size_t len)
+{
+        char svxbuf[8192];
+        size_t n;
+
+        if (from == to)
+                return SOX_SUCCESS;
+        while (len) {
+                n = min(len, sizeof(svxbuf));
+                len -= n;
+                if (to > from) {        /* copy from the end backwards */
+                        if (lsx_seeki(ft, from + (off_t)len, SEEK_SET) ||
+                            lsx_readbuf(ft, svxbuf, n) != n ||
+                            lsx_seeki(ft, to + (off_t)len, SEEK_SET) ||
+                            lsx_writebuf(ft, svxbuf, n) != n)
+                                return SOX_EOF;
+                }
+                else {
+                        if (lsx_seeki(ft, from, SEEK_SET) ||
+                            lsx_readbuf(ft, svxbuf, n) != n ||
+                            lsx_seeki(ft, to, SEEK_SET) ||
+                            lsx_writebuf(ft, svxbuf, n) != n)
+                                return SOX_EOF;
+                        from += n;
+                        to += n;
+                }
+        }
+        return SOX_SUCCESS;
+}
+
+/* Appends a channel's temporary data at the current output position */
+static int append_tmp(sox_format_t * ft, lsx_tmpbuf_t * tmp)
+{
+        char svxbuf[8192];
+        uint64_t pos;
+        size_t n;
+
+        for (pos = 0; pos < tmp->length; pos += n)
+                if ((n = lsx_tmpbuf_read(tmp, pos, svxbuf, sizeof(svxbuf))) == 0 ||
+                    lsx_writebuf(ft, svxbuf, n) != n)
+                        return SOX_EOF;
+        return SOX_SUCCESS;
+}
+
 static int stopwrite(sox_format_t * ft)
 {
         priv_t * p = (priv_t * ) ft->priv;
 
-        size_t i, len;
-        char svxbuf[512];
-
-        /* append all channel pieces to channel 0 */
-        /* close temp files */
-        for (i = 1; i < ft->signal.channels; i++) {
-                if (fseeko(p->ch[i], (off_t)0, 0))
-                {
-                        lsx_fail_errno (ft,errno,"Can't rewind channel output file %lu",(unsigned long)i);
-                        return(SOX_EOF);
+        size_t i, chans = ft->signal.channels;
+        off_t body = SVXHEADERSIZE;
+        int result = SOX_SUCCESS;
+
+        if (p->region && p->written != p->region) {
+                lsx_debug("length estimate was %lu, actual %lu",
+                    (unsigned long)(p->region * chans), (unsigned long)p->nsamples);
+                if (p->written < p->region)     /* close up the gaps */
+                        for (i = 1; result == SOX_SUCCESS && i < chans; i++)
+                                result = move_data(ft, body + (off_t)(i * p->region),
+                                    body + (off_t)(i * p->written), p->written);
+                else for (i = chans; result == SOX_SUCCESS && i-- > 0;) {
+                        /* widen the regions; append what did not fit */
+                        result = move_data(ft, body + (off_t)(i * p->region),
+                            body + (off_t)(i * p->written), p->region);
+                        if (result == SOX_SUCCESS && !(result = lsx_seeki(ft,
+                            body + (off_t)(i * p->written + p->region), SEEK_SET)))
+                                result = append_tmp(ft, &p->tmp[i]);
                 }
-                while (!feof(p->ch[i])) {
-                        len = fread(svxbuf, (size_t) 1, (size_t) 512, p->ch[i]);
-                        if (fwrite (svxbuf, (size_t) 1, len, p->ch[0]) != len) {
-                          lsx_fail_errno (ft,errno,"Can't write channel output file %lu",(unsigned long)i);
-                          return SOX_EOF;
-                        }
-                }
-                fclose (p->ch[i]);
         }
+        else if (!p->region) /* append all channel pieces to channel 0 */
+                for (i = 1; result == SOX_SUCCESS && i < chans; i++)
+                        result = append_tmp(ft, &p->tmp[i]);
+
+        for (i = 0; i < chans; i++)
+                lsx_tmpbuf_close(&p->tmp[i]);
+        if (result != SOX_SUCCESS) {
+                lsx_fail_errno(ft, errno, "Can't assemble channel data");
+                return SOX_EOF;
+        }
+
+        if (p->region && lsx_seeki(ft, body + (off_t)p->nsamples, SEEK_SET))
+                return SOX_EOF;
 
         /* add a pad byte if BODY size is odd */
         if(p->nsamples % 2 != 0)
             lsx_writeb(ft, '\0');
 
+#ifdef HAVE_UNISTD_H
+        /* drop any unused reservation */
+        if (p->region && p->written < p->region) {
+                fflush(ft->fp);
+                if (ftruncate(fileno(ft->fp), body + (off_t)(p->nsamples + p->nsamples % 2)))
+                        lsx_debug("can't truncate output file");
+        }
+#endif
+
         /* fixup file sizes in header */
         if (lsx_seeki(ft, (off_t)0, 0) != 0)
         {
@@ -318,7 +410,6 @@ static int stopwrite(sox_format_t * ft)
 /*======================================================================*/
 /*                         8SVXWRITEHEADER                              */
 /*======================================================================*/
-#define SVXHEADERSIZE 100
 static void svxwriteheader(sox_format_t * ft, size_t nsamples)
 {
         size_t formsize =  nsamples + SVXHEADERSIZE - 8;
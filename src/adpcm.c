@@ -244,54 +244,120 @@ static int AdpcmMashS(
         return (int) sqrt(d2);
 }
 
-static inline void AdpcmMashChannel(
+/* AdpcmMashErrs() is AdpcmMashS() without output, run for 7 (coef set,
+ * initial step) trials at once.  The trials are independent, so advancing
+ * them together one sample at a time lets their serial dependency chains
+ * overlap.  probe[k] is set to the step that AdpcmMashS() would return
+ * after encoding only the first n0 samples of trial k. */
+static void AdpcmMashErrs(
+        unsigned ch,              /* channel number to encode, REQUIRE 0 <= ch < chans  */
+        unsigned chans,           /* total channels */
+        SAMPL v[2],          /* values to use as starting 2 */
+        const SAMPL *ibuff,  /* ibuff[] is interleaved input samples */
+        int n,               /* samples to encode PER channel */
+        int n0,              /* samples after which to record probe[] */
+        const int step0[7],  /* initial step for each coef set, 16 <= step0[k] */
+        int probe[7],        /* output: step after n0 samples, or NULL */
+        int err[7]           /* output: rms error, as AdpcmMashS() */
+)
+{
+        const SAMPL *ip = ibuff + ch;
+        int v0[7], v1[7], step[7];
+        double d2[7];
+        int i, k, d;
+
+        d = ip[0] - v[1];
+        d2[0] = d*d;
+        d = ip[chans] - v[0];
+        d2[0] += d*d;
+        for (k = 0; k < 7; k++) {
+                v0[k] = v[0];
+                v1[k] = v[1];
+                step[k] = step0[k];
+                d2[k] = d2[0];
+                if (probe) probe[k] = step0[k];
+        }
+        for (i = 2; i < n; i++) {
+                int x = ip[i*chans];
+                if (probe && i == n0)
+                        for (k = 0; k < 7; k++)
+                                probe[k] = step[k];
+                for (k = 0; k < 7; k++) {
+                        int vlin, dp, c;
+
+                        vlin = (v0[k] * lsx_ms_adpcm_i_coef[k][0] + v1[k] * lsx_ms_adpcm_i_coef[k][1]) >> 8;
+                        dp = x - vlin + (step[k]<<3) + (step[k]>>1);
+                        c = 0;
+                        if (dp>0) {
+                                c = dp/step[k];
+                                if (c>15) c = 15;
+                        }
+                        c -= 8;
+                        dp = c * step[k];
+                        c &= 0x0f;
+
+                        v1[k] = v0[k];
+                        v0[k] = vlin + dp;
+                        if (v0[k]<-0x8000) v0[k] = -0x8000;
+                        else if (v0[k]>0x7fff) v0[k] = 0x7fff;
+
+                        d = x - v0[k];
+                        d2[k] += d*d;
+
+                        step[k] = (stepAdjustTable[c] * step[k]) >> 8;
+                        if (step[k] < 16) step[k] = 16;
+                }
+        }
+        for (k = 0; k < 7; k++)
+                err[k] = (int) sqrt(d2[k] / n);
+}
+
+/* choose the coef set and initial step with which to encode one channel */
+static int AdpcmMashChannel(
         unsigned ch,             /* channel number to encode, REQUIRE 0 <= ch < chans  */
         unsigned chans,          /* total channels */
         const SAMPL *ip,    /* ip[] is interleaved input samples */
         int n,              /* samples to encode PER channel, REQUIRE */
-        int *st,            /* input/output steps, 16<=st[i] */
-        unsigned char *obuff /* output buffer[blockAlign] */
+        int *st             /* input/output steps, 16<=st[i] */
 )
 {
         SAMPL v[2];
-        int n0,s0,s1,ss,smin;
-        int d,dmin,k,kmin;
+        int n0,s0[7],s1[7],smin;
+        int d0[7],d1[7],dmin,k,kmin;
 
         n0 = n/2; if (n0>32) n0=32;
         if (*st<16) *st = 16;
         v[1] = ip[ch];
         v[0] = ip[ch+chans];
 
-        dmin = 0; kmin = 0; smin = 0;
         /* for each of 7 standard coeff sets, we try compression
          * beginning with last step-value, and with slightly
-         * forward-adjusted step-value, taking best of the 14
+         * forward-adjusted step-value, taking best of the 14.
+         * The forward adjustment comes from the step reached after the
+         * first n0 samples, which the first trial yields on the way.
          */
+        for (k=0; k<7; k++)
+                s0[k] = *st;
+        AdpcmMashErrs(ch, chans, v, ip, n, n0, s0, s1, d0); /* with step s0 */
+        for (k=0; k<7; k++)
+                s1[k] = (3*s0[k]+s1[k])/4;
+        AdpcmMashErrs(ch, chans, v, ip, n, n0, s1, NULL, d1); /* with step s1 */
+
+        dmin = 0; kmin = 0; smin = 0;
         for (k=0; k<7; k++) {
-                int d0,d1;
-                ss = s0 = *st;
-                d0=AdpcmMashS(ch, chans, v, lsx_ms_adpcm_i_coef[k], ip, n, &ss, NULL); /* with step s0 */
-
-                s1 = s0;
-                AdpcmMashS(ch, chans, v, lsx_ms_adpcm_i_coef[k], ip, n0, &s1, NULL);
-                lsx_debug_more(" s32 %d\n",s1);
-                ss = s1 = (3*s0+s1)/4;
-                d1=AdpcmMashS(ch, chans, v, lsx_ms_adpcm_i_coef[k], ip, n, &ss, NULL); /* with step s1 */
-                if (!k || d0<dmin || d1<dmin) {
+                if (!k || d0[k]<dmin || d1[k]<dmin) {
                         kmin = k;
-                        if (d0<=d1) {
-                                dmin = d0;
-                                smin = s0;
+                        if (d0[k]<=d1[k]) {
+                                dmin = d0[k];
+                                smin = s0[k];
                         }else{
-                                dmin = d1;
-                                smin = s1;
+                                dmin = d1[k];
+                                smin = s1[k];
                         }
                 }
         }
         *st = smin;
-        lsx_debug_more("kmin %d, smin %5d, ",kmin,smin);
-        d=AdpcmMashS(ch, chans, v, lsx_ms_adpcm_i_coef[kmin], ip, n, st, obuff);
-        obuff[ch] = kmin;
+        return kmin;
 }
 
 void lsx_ms_adpcm_block_mash_i(
@@ -303,7 +369,7 @@ void lsx_ms_adpcm_block_mash_i(
         int blockAlign      /* >= 7*chans + chans*(n-2)/2.0    */
 )
 {
-        unsigned ch;
+        int ch, kmin[16];  /* chans <= 16, as checked by wav.c */
         unsigned char *p;
 
         lsx_debug_more("AdpcmMashI(chans %d, ip %p, n %d, st %p, obuff %p, bA %d)\n",
@@ -311,8 +377,22 @@ void lsx_ms_adpcm_block_mash_i(
 
         for (p=obuff+7*chans; p<obuff+blockAlign; p++) *p=0;
 
-        for (ch=0; ch<chans; ch++)
-                AdpcmMashChannel(ch, chans, ip, n, st+ch, obuff);
+        /* The search dominates and channels' searches are independent, but
+         * channels share output bytes so are then encoded one at a time */
+#ifdef HAVE_OPENMP
+        #pragma omp parallel for if (chans > 1)
+#endif
+        for (ch=0; ch<(int)chans; ch++)
+                kmin[ch] = AdpcmMashChannel((unsigned)ch, chans, ip, n, st+ch);
+
+        for (ch=0; ch<(int)chans; ch++) {
+                SAMPL v[2];
+                v[1] = ip[ch];
+                v[0] = ip[ch+chans];
+                lsx_debug_more("kmin %d, smin %5d, ",kmin[ch],st[ch]);
+                AdpcmMashS((unsigned)ch, chans, v, lsx_ms_adpcm_i_coef[kmin[ch]], ip, n, st+ch, obuff);
+                obuff[ch] = kmin[ch];
+        }
 }
 
 /*
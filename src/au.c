@@ -84,42 +84,49 @@ typedef struct {        /* For G72x decoding: */
   int (*dec_routine)(int i, int out_coding, struct g72x_state *state_ptr);
   unsigned int in_buffer;
   int in_bits;
+  unsigned char * in;      /* Bytes read for dec_read; grows as needed */
+  size_t in_size;
 } priv_t;
 
 /*
- * Unpack input codes and pass them back as bytes.
- * Returns 1 if there is residual input, returns -1 if eof, else returns 0.
+ * Unpack input codes and pass them back decoded.  Bytes are read only as
+ * they are needed (so none is consumed beyond the last code returned), but
+ * all those needed for the request are read in one go.
  * (Adapted from Sun's decode.c.)
  */
-static int unpack_input(sox_format_t * ft, unsigned char *code)
+static size_t dec_read(sox_format_t *ft, sox_sample_t *buf, size_t samp)
 {
-  priv_t * p = (priv_t *) ft->priv;
-  unsigned char           in_byte;
-
-  if (p->in_bits < (int)ft->encoding.bits_per_sample) {
-    if (lsx_read_b_buf(ft, &in_byte, (size_t) 1) != 1) {
-      *code = 0;
-      return -1;
+  priv_t * p = (priv_t *)ft->priv;
+  int bits = ft->encoding.bits_per_sample, mask = (1 << bits) - 1;
+  size_t nbytes = 0, i = 0, done;
+
+  if (samp * bits > (size_t)p->in_bits)
+    nbytes = (samp * bits - p->in_bits + 7) / 8;
+  if (nbytes > p->in_size)
+    p->in = lsx_realloc(p->in, p->in_size = nbytes);
+  nbytes = lsx_read_b_buf(ft, p->in, nbytes);
+
+  for (done = 0; done < samp; ++done) {
+    if (p->in_bits < bits) {
+      if (i == nbytes)
+        break;
+      p->in_buffer |= p->in[i++] << p->in_bits;
+      p->in_bits += 8;
     }
-    p->in_buffer |= (in_byte << p->in_bits);
-    p->in_bits += 8;
+    *buf++ = SOX_SIGNED_16BIT_TO_SAMPLE(
+        (*p->dec_routine)((int)(p->in_buffer & mask), AUDIO_ENCODING_LINEAR, &p->state),);
+    p->in_buffer >>= bits;
+    p->in_bits -= bits;
   }
-  *code = p->in_buffer & ((1 << ft->encoding.bits_per_sample) - 1);
-  p->in_buffer >>= ft->encoding.bits_per_sample;
-  p->in_bits -= ft->encoding.bits_per_sample;
-  return p->in_bits > 0;
+  return done;
 }
 
-static size_t dec_read(sox_format_t *ft, sox_sample_t *buf, size_t samp)
+static int stopread(sox_format_t * ft)
 {
   priv_t * p = (priv_t *)ft->priv;
-  unsigned char code;
-  size_t done;
 
-  for (done = 0; samp > 0 && unpack_input(ft, &code) >= 0; ++done, --samp)
-    *buf++ = SOX_SIGNED_16BIT_TO_SAMPLE(
-        (*p->dec_routine)(code, AUDIO_ENCODING_LINEAR, &p->state),);
-  return done;
+  free(p->in);
+  return SOX_SUCCESS;
 }
 
 static int startread(sox_format_t * ft)
@@ -224,7 +231,7 @@ LSX_FORMAT_HANDLER(au)
   static sox_format_handler_t const handler = {SOX_LIB_VERSION_CODE,
     "PCM file format used widely on Sun systems",
     names, SOX_FILE_BIG_END | SOX_FILE_REWIND,
-    startread, lsx_rawread, NULL,
+    startread, lsx_rawread, stopread,
     write_header, lsx_rawwrite, NULL,
     lsx_rawseek, write_encodings, NULL, sizeof(priv_t)
   };
@@ -58,6 +58,8 @@ int lsx_biquad_getopts(sox_effect_t * effp, int argc, char **argv,
 }
 
 
+#define BLOCK_LEN 256 /* Wide samples filtered (by each stage) at a time */
+
 static int start(sox_effect_t * effp)
 {
   priv_t * p = (priv_t *)effp->priv;
@@ -68,11 +70,68 @@ static int start(sox_effect_t * effp)
   p->a2 /= p->a0;
   p->a1 /= p->a0;
 
-  p->o2 = p->o1 = p->i2 = p->i1 = 0;
+  p->num_stages = 1;
+  p->stages = lsx_malloc(5 * sizeof(*p->stages));
+  p->stages[0] = p->b0, p->stages[1] = p->b1, p->stages[2] = p->b2;
+  p->stages[3] = p->a1, p->stages[4] = p->a2;
+  p->state = lsx_calloc(4 * effp->in_signal.channels, sizeof(*p->state));
+  p->names = lsx_malloc(sizeof(*p->names));
+  p->names[0] = effp->handler.name;
+  p->clips = lsx_calloc(1, sizeof(*p->clips));
+  p->buf = lsx_malloc(BLOCK_LEN * effp->in_signal.channels * sizeof(*p->buf));
   return SOX_SUCCESS;
 }
 
 
+#undef lsx_warn /* The subsystem is set here to each fused effect's name */
+
+int lsx_biquad_stop(sox_effect_t * effp)
+{
+  priv_t * p = (priv_t *)effp->priv;
+  unsigned s;
+
+  if (p->num_stages > 1) { /* Report clips by each of the fused effects */
+    for (s = 0; s < p->num_stages; ++s) if (p->clips[s]) {
+      sox_globals.subsystem = p->names[s];
+      lsx_warn("%s clipped %lu samples; decrease volume?",
+          p->names[s], (unsigned long)p->clips[s]);
+    }
+    effp->clips = 0; /* So not reported again, all under the first effect */
+  }
+  free(p->clips);
+  free(p->names);
+  free(p->buf);
+  free(p->state);
+  free(p->stages);
+  return SOX_SUCCESS;
+}
+
+
+/* Fusing a run of biquad effects into one cascade lets them all be applied
+ * in one pass over the audio (and also avoids intermediate rounding). */
+sox_bool lsx_biquad_fuse(sox_effect_t * effp, sox_effect_t * next)
+{
+  priv_t * p = (priv_t *)effp->priv, * q = (priv_t *)next->priv;
+  unsigned chans = effp->out_signal.channels, n;
+
+  if (effp->handler.flow != lsx_biquad_flow || next->handler.flow !=
+      lsx_biquad_flow || effp->flows != 1 || next->in_signal.channels != chans)
+    return sox_false;
+  n = p->num_stages + q->num_stages;
+  p->stages = lsx_realloc(p->stages, 5 * n * sizeof(*p->stages));
+  memcpy(p->stages + 5 * p->num_stages, q->stages, 5 * q->num_stages * sizeof(*p->stages));
+  p->state = lsx_realloc(p->state, 4 * chans * n * sizeof(*p->state));
+  memcpy(p->state + 4 * chans * p->num_stages, q->state, 4 * chans * q->num_stages * sizeof(*p->state));
+  p->names = lsx_realloc(p->names, n * sizeof(*p->names));
+  memcpy(p->names + p->num_stages, q->names, q->num_stages * sizeof(*p->names));
+  p->clips = lsx_realloc(p->clips, n * sizeof(*p->clips));
+  memcpy(p->clips + p->num_stages, q->clips, q->num_stages * sizeof(*p->clips));
+  p->num_stages = n;
+  lsx_biquad_stop(next);
+  return sox_true;
+}
+
+
 int lsx_biquad_start(sox_effect_t * effp)
 {
   priv_t * p = (priv_t *)effp->priv;
@@ -122,16 +181,74 @@ int lsx_biquad_start(sox_effect_t * effp)
 }
 
 
+/* Applies one stage to `width' (1 or 2) adjacent channels of buf.  With two,
+ * the channels' recurrences are independent so can proceed in parallel (in
+ * SIMD lanes, or at least overlapped). */
+static void stage(double const * c, double * state, unsigned width,
+    double * buf, size_t stride, size_t len)
+{
+  double i1[2], i2[2], o1[2], o2[2];
+  unsigned j;
+
+  for (j = 0; j < width; ++j) {
+    i1[j] = state[4 * j], i2[j] = state[4 * j + 1];
+    o1[j] = state[4 * j + 2], o2[j] = state[4 * j + 3];
+  }
+  for (; len--; buf += stride) for (j = 0; j < width; ++j) {
+    double o0 = buf[j]*c[0] + i1[j]*c[1] + i2[j]*c[2] - o1[j]*c[3] - o2[j]*c[4];
+    i2[j] = i1[j], i1[j] = buf[j];
+    o2[j] = o1[j], o1[j] = buf[j] = o0;
+  }
+  for (j = 0; j < width; ++j) {
+    state[4 * j] = i1[j], state[4 * j + 1] = i2[j];
+    state[4 * j + 2] = o1[j], state[4 * j + 3] = o2[j];
+  }
+}
+
+
+/* Between fused stages, clip as the separate effects' outputs would have
+ * been (but without rounding): */
+static size_t clip(double * buf, size_t len)
+{
+  size_t clips = 0;
+
+  for (; len--; ++buf) {
+    if (*buf <= SOX_SAMPLE_MIN - 0.5)
+      *buf = SOX_SAMPLE_MIN, ++clips;
+    else if (*buf >= SOX_SAMPLE_MAX + 0.5)
+      *buf = SOX_SAMPLE_MAX, ++clips;
+  }
+  return clips;
+}
+
+
 int lsx_biquad_flow(sox_effect_t * effp, const sox_sample_t *ibuf,
     sox_sample_t *obuf, size_t *isamp, size_t *osamp)
 {
   priv_t * p = (priv_t *)effp->priv;
-  size_t len = *isamp = *osamp = min(*isamp, *osamp);
-  while (len--) {
-    double o0 = *ibuf*p->b0 + p->i1*p->b1 + p->i2*p->b2 - p->o1*p->a1 - p->o2*p->a2;
-    p->i2 = p->i1, p->i1 = *ibuf++;
-    p->o2 = p->o1, p->o1 = o0;
-    *obuf++ = SOX_ROUND_CLIP_COUNT(o0, effp->clips);
+  size_t chans = effp->in_signal.channels, i, c, n, clips;
+  size_t len = *isamp = *osamp = min(*isamp, *osamp) / chans * chans;
+  unsigned s;
+
+  for (; len; len -= n, ibuf += n, obuf += n) {
+    n = min(len, BLOCK_LEN * chans);
+    for (i = 0; i < n; ++i)
+      p->buf[i] = ibuf[i];
+    for (s = 0; s < p->num_stages; ++s) {
+      double const * coefs = p->stages + 5 * s;
+      double * state = p->state + 4 * chans * s;
+      for (c = 0; c + 1 < chans; c += 2)
+        stage(coefs, state + 4 * c, 2u, p->buf + c, chans, n / chans);
+      if (c < chans)
+        stage(coefs, state + 4 * c, 1u, p->buf + c, chans, n / chans);
+      if (s + 1 < p->num_stages) {
+        clips = clip(p->buf, n);
+        p->clips[s] += clips, effp->clips += clips;
+      }
+    }
+    for (clips = 0, i = 0; i < n; ++i)
+      obuf[i] = SOX_ROUND_CLIP_COUNT(p->buf[i], clips);
+    p->clips[s - 1] += clips, effp->clips += clips;
   }
   return SOX_SUCCESS;
 }
@@ -151,8 +268,8 @@ static int create(sox_effect_t * effp, int argc, char * * argv)
 sox_effect_handler_t const * lsx_biquad_effect_fn(void)
 {
   static sox_effect_handler_t handler = {
-    "biquad", "b0 b1 b2 a0 a1 a2", 0,
-    create, start, lsx_biquad_flow, NULL, NULL, NULL, sizeof(priv_t)
+    "biquad", "b0 b1 b2 a0 a1 a2", SOX_EFF_MCHAN,
+    create, start, lsx_biquad_flow, NULL, lsx_biquad_stop, NULL, sizeof(priv_t)
   };
   return &handler;
 }
@@ -64,8 +64,12 @@ typedef struct {
   double b0, b1, b2;       /* Filter coefficients */
   double a0, a1, a2;       /* Filter coefficients */
 
-  sox_sample_t i1, i2;     /* Filter memory */
-  double      o1, o2;      /* Filter memory */
+  unsigned num_stages;     /* > 1 if following biquads have been fused in */
+  double * stages;         /* Normalised b0 b1 b2 a1 a2, for each stage */
+  double * state;          /* Filter memory: i1 i2 o1 o2, per stage & channel */
+  char const * * names;    /* Effect name, per stage */
+  size_t * clips;          /* Samples clipped, per stage */
+  double * buf;            /* Block of samples being filtered */
 } biquad_t;
 
 int lsx_biquad_getopts(sox_effect_t * effp, int n, char **argv,
@@ -74,5 +78,6 @@ int lsx_biquad_getopts(sox_effect_t * effp, int n, char **argv,
 int lsx_biquad_start(sox_effect_t * effp);
 int lsx_biquad_flow(sox_effect_t * effp, const sox_sample_t *ibuf, sox_sample_t *obuf,
                         size_t *isamp, size_t *osamp);
+int lsx_biquad_stop(sox_effect_t * effp);
 
 #endif
@@ -73,14 +73,13 @@
 typedef struct {
         int     num_chorus;
         int     modulation[MAX_CHORUS];
-        int     counter;
-        long    phase[MAX_CHORUS];
-        float   *chorusbuf;
+        size_t  phase[MAX_CHORUS];
+        lsx_delay_line_t chorusbuf;
         float   in_gain, out_gain;
         float   delay[MAX_CHORUS], decay[MAX_CHORUS];
         float   speed[MAX_CHORUS], depth[MAX_CHORUS];
         long    length[MAX_CHORUS];
-        int     *lookup_tab[MAX_CHORUS];
+        int     *lookup_tab[MAX_CHORUS];    /* Delay, in samples */
         int     depth_samples[MAX_CHORUS], samples[MAX_CHORUS];
         int maxsamples;
         unsigned int fade_out;
@@ -222,15 +221,55 @@ static int sox_chorus_start(sox_effect_t * effp)
         lsx_warn("chorus: warning >>> gain-out can cause saturation or clipping of output <<<");
 
 
-        chorus->chorusbuf = lsx_malloc(sizeof (float) * chorus->maxsamples);
-        for ( i = 0; i < chorus->maxsamples; i++ )
-                chorus->chorusbuf[i] = 0.0;
+        /* An offset of 0 into the circular buffer of old (maxsamples)
+         * samples gets the oldest: */
+        for ( i = 0; i < chorus->num_chorus; i++ ) {
+                long j;
+                for ( j = 0; j < chorus->length[i]; j++ )
+                        if ( chorus->lookup_tab[i][j] == 0 )
+                                chorus->lookup_tab[i][j] = chorus->maxsamples;
+        }
 
-        chorus->counter = 0;
+        lsx_delay_line_create(&chorus->chorusbuf, (size_t)chorus->maxsamples);
         chorus->fade_out = chorus->maxsamples;
         return (SOX_SUCCESS);
 }
 
+/*
+ * Process len samples from ibuf (or silence, if NULL) to obuf.
+ */
+static void sox_chorus(sox_effect_t * effp, const sox_sample_t *ibuf, sox_sample_t *obuf,
+                   size_t len)
+{
+        priv_t * chorus = (priv_t *) effp->priv;
+        int i;
+        int delay[LSX_DELAY_LINE_BLOCK_LEN];
+        float d_out[LSX_DELAY_LINE_BLOCK_LEN];
+        size_t j, n;
+
+        for (; len; len -= n) {
+                /* Store delays as 24-bit signed longs */
+                double * d_in = lsx_delay_line_write(&chorus->chorusbuf,
+                        n = min(len, array_length(d_out)));
+                for ( j = 0; j < n; j++ ) {
+                        d_in[j] = ibuf? (float) *ibuf++ / 256 : 0;
+                        d_out[j] = (float)d_in[j] * chorus->in_gain;
+                }
+                /* Mix in the delays, each over the whole block */
+                for ( i = 0; i < chorus->num_chorus; i++ ) {
+                        lsx_read_wave_table(SOX_INT, chorus->lookup_tab[i],
+                                (size_t)chorus->length[i], &chorus->phase[i], delay, n);
+                        for ( j = 0; j < n; j++ )
+                                d_out[j] += (float)d_in[(ptrdiff_t)j - delay[j]] * chorus->decay[i];
+                }
+                for ( j = 0; j < n; j++ ) {
+                        /* Adjust the output volume and size to 24 bit */
+                        float out = d_out[j] * chorus->out_gain;
+                        *obuf++ = SOX_24BIT_CLIP_COUNT((sox_sample_t) out, effp->clips) * 256;
+                }
+        }
+}
+
 /*
  * Processed signed long samples from ibuf to obuf.
  * Return number of samples processed.
@@ -238,34 +277,10 @@ static int sox_chorus_start(sox_effect_t * effp)
 static int sox_chorus_flow(sox_effect_t * effp, const sox_sample_t *ibuf, sox_sample_t *obuf,
                    size_t *isamp, size_t *osamp)
 {
-        priv_t * chorus = (priv_t *) effp->priv;
-        int i;
-        float d_in, d_out;
-        sox_sample_t out;
         size_t len = min(*isamp, *osamp);
         *isamp = *osamp = len;
 
-        while (len--) {
-                /* Store delays as 24-bit signed longs */
-                d_in = (float) *ibuf++ / 256;
-                /* Compute output first */
-                d_out = d_in * chorus->in_gain;
-                for ( i = 0; i < chorus->num_chorus; i++ )
-                        d_out += chorus->chorusbuf[(chorus->maxsamples +
-                        chorus->counter - chorus->lookup_tab[i][chorus->phase[i]]) %
-                        chorus->maxsamples] * chorus->decay[i];
-                /* Adjust the output volume and size to 24 bit */
-                d_out = d_out * chorus->out_gain;
-                out = SOX_24BIT_CLIP_COUNT((sox_sample_t) d_out, effp->clips);
-                *obuf++ = out * 256;
-                /* Mix decay of delay and input */
-                chorus->chorusbuf[chorus->counter] = d_in;
-                chorus->counter =
-                        ( chorus->counter + 1 ) % chorus->maxsamples;
-                for ( i = 0; i < chorus->num_chorus; i++ )
-                        chorus->phase[i]  =
-                                ( chorus->phase[i] + 1 ) % chorus->length[i];
-        }
+        sox_chorus(effp, ibuf, obuf, len);
         /* processed all samples */
         return (SOX_SUCCESS);
 }
@@ -276,35 +291,10 @@ static int sox_chorus_flow(sox_effect_t * effp, const sox_sample_t *ibuf, sox_sa
 static int sox_chorus_drain(sox_effect_t * effp, sox_sample_t *obuf, size_t *osamp)
 {
         priv_t * chorus = (priv_t *) effp->priv;
-        size_t done;
-        int i;
+        size_t done = min(*osamp, chorus->fade_out);
 
-        float d_in, d_out;
-        sox_sample_t out;
-
-        done = 0;
-        while ( ( done < *osamp ) && ( done < chorus->fade_out ) ) {
-                d_in = 0;
-                d_out = 0;
-                /* Compute output first */
-                for ( i = 0; i < chorus->num_chorus; i++ )
-                        d_out += chorus->chorusbuf[(chorus->maxsamples +
-                chorus->counter - chorus->lookup_tab[i][chorus->phase[i]]) %
-                chorus->maxsamples] * chorus->decay[i];
-                /* Adjust the output volume and size to 24 bit */
-                d_out = d_out * chorus->out_gain;
-                out = SOX_24BIT_CLIP_COUNT((sox_sample_t) d_out, effp->clips);
-                *obuf++ = out * 256;
-                /* Mix decay of delay and input */
-                chorus->chorusbuf[chorus->counter] = d_in;
-                chorus->counter =
-                        ( chorus->counter + 1 ) % chorus->maxsamples;
-                for ( i = 0; i < chorus->num_chorus; i++ )
-                        chorus->phase[i]  =
-                                ( chorus->phase[i] + 1 ) % chorus->length[i];
-                done++;
-                chorus->fade_out--;
-        }
+        sox_chorus(effp, NULL, obuf, done);
+        chorus->fade_out -= done;
         /* samples played, it remains */
         *osamp = done;
         if (chorus->fade_out == 0)
@@ -321,8 +311,7 @@ static int sox_chorus_stop(sox_effect_t * effp)
         priv_t * chorus = (priv_t *) effp->priv;
         int i;
 
-        free(chorus->chorusbuf);
-        chorus->chorusbuf = NULL;
+        lsx_delay_line_delete(&chorus->chorusbuf);
         for ( i = 0; i < chorus->num_chorus; i++ ) {
                 free(chorus->lookup_tab[i]);
                 chorus->lookup_tab[i] = NULL;
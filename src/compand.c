@@ -160,18 +160,17 @@ static int start(sox_effect_t * effp)
 }
 
 /*
- * Update a volume value using the given sample
- * value, the attack rate and decay rate
+ * Update a volume value using the given sample value, the attack rate (if
+ * the volume is increasing) and decay rate.  Written with a select rather
+ * than a branch, so that it compiles to straight-line code.
  */
 static void doVolume(double *v, double samp, priv_t * l, int chan)
 {
   double s = -samp / SOX_SAMPLE_MIN;
   double delta = s - *v;
+  double const * rates = l->channels[chan].attack_times;
 
-  if (delta > 0.0) /* increase volume according to attack rate */
-    *v += delta * l->channels[chan].attack_times[0];
-  else             /* reduce volume according to decay rate */
-    *v += delta * l->channels[chan].attack_times[1];
+  *v += delta * rates[delta <= 0.0];
 }
 
 static int flow(sox_effect_t * effp, const sox_sample_t *ibuf, sox_sample_t *obuf,
@@ -185,29 +184,27 @@ static int flow(sox_effect_t * effp, const sox_sample_t *ibuf, sox_sample_t *obu
   for (idone = 0,odone = 0; idone < len; ibuf += filechans) {
     int chan;
 
+    double level_out_lin = 0;
+
     /* Maintain the volume fields by simulating a leaky pump circuit */
-    for (chan = 0; chan < filechans; ++chan) {
-      if (l->expectedChannels == 1 && filechans > 1) {
-        /* User is expecting same compander for all channels */
-        int i;
-        double maxsamp = 0.0;
-        for (i = 0; i < filechans; ++i) {
-          double rect = fabs((double)ibuf[i]);
-          if (rect > maxsamp) maxsamp = rect;
-        }
-        doVolume(&l->channels[0].volume, maxsamp, l, 0);
-        break;
-      } else
-        doVolume(&l->channels[chan].volume, fabs((double)ibuf[chan]), l, chan);
+    if (l->expectedChannels == 1) {
+      /* User is expecting same compander for all channels */
+      double maxsamp = 0.0;
+      for (chan = 0; chan < filechans; ++chan)
+        maxsamp = max(maxsamp, fabs((double)ibuf[chan]));
+      doVolume(&l->channels[0].volume, maxsamp, l, 0);
+      level_out_lin = lsx_compandt(&l->transfer_fn, l->channels[0].volume);
     }
+    else for (chan = 0; chan < filechans; ++chan)
+      doVolume(&l->channels[chan].volume, fabs((double)ibuf[chan]), l, chan);
 
     /* Volume memory is updated: perform compand */
     for (chan = 0; chan < filechans; ++chan) {
-      int ch = l->expectedChannels > 1 ? chan : 0;
-      double level_in_lin = l->channels[ch].volume;
-      double level_out_lin = lsx_compandt(&l->transfer_fn, level_in_lin);
       double checkbuf;
 
+      if (l->expectedChannels > 1)
+        level_out_lin = lsx_compandt(&l->transfer_fn, l->channels[chan].volume);
+
       if (l->delay_buf_size <= 0) {
         checkbuf = ibuf[chan] * level_out_lin;
         SOX_SAMPLE_CLIP_COUNT(checkbuf, effp->clips);
@@ -17,6 +17,8 @@
 
 #include <math.h>
 
+#define LSX_COMPANDT_BITS 7 /* The gain table has 2^this points per octave */
+
 typedef struct {
   struct sox_compandt_segment {
     double x, y;              /* 1st point in segment */
@@ -26,27 +28,37 @@ typedef struct {
   double out_min_lin;
   double outgain_dB;        /* Post processor gain */
   double curve_dB;
+  double * table;           /* Gain, from table_min_lin up to 1 (inclusive) */
+  double table_min_lin;     /* A power of 2 */
+  uint64_t table_offset;    /* Index bits (see below) of table_min_lin */
+  size_t table_len;
 } sox_compandt_t;
 
 sox_bool lsx_compandt_parse(sox_compandt_t * t, char * points, char * gain);
 sox_bool lsx_compandt_show(sox_compandt_t * t, sox_plot_t plot);
 void    lsx_compandt_kill(sox_compandt_t * p);
+double  lsx_compandt_exact(sox_compandt_t * t, double in_lin);
 
-/* Place in header to allow in-lining */
+/* Place in header to allow in-lining.  The gain is interpolated from a table
+ * indexed by the input level's exponent & leading mantissa bits, i.e. by a
+ * piecewise-linear approximation to its log2.  See compandt.c for the error
+ * bound. */
 static double lsx_compandt(sox_compandt_t * t, double in_lin)
 {
-  struct sox_compandt_segment * s;
-  double in_log, out_log;
+  union {double d; uint64_t i;} x;
+  double const * g;
+  double frac;
 
   if (in_lin <= t->in_min_lin)
     return t->out_min_lin;
+  if (in_lin >= 1)
+    return t->table[t->table_len - 1];
+  if (in_lin < t->table_min_lin)
+    return lsx_compandt_exact(t, in_lin);
 
-  in_log = log(in_lin);
-
-  for (s = t->segments + 1; in_log > s[1].x; ++s);
-
-  in_log -= s->x;
-  out_log = s->y + in_log * (s->a * in_log + s->b);
-
-  return exp(out_log);
+  x.d = in_lin;
+  g = t->table + ((x.i >> (52 - LSX_COMPANDT_BITS)) - t->table_offset);
+  frac = (double)(x.i & (((uint64_t)1 << (52 - LSX_COMPANDT_BITS)) - 1)) *
+      (1. / ((uint64_t)1 << (52 - LSX_COMPANDT_BITS)));
+  return g[0] + (g[1] - g[0]) * frac;
 }
@@ -78,7 +78,7 @@ static float float_conv_enc(float const *fp1, float const *fp2)
 {
     /* This is a specialzed version of float_conv() for encoding
      * which simply assumes a CVSD_ENC_FILTERLEN (16) length of
-     * the two arrays and unrolls that loop.
+     * the two arrays.
      *
      * fp1 should be the enc.input_filter array and must be 
      * CVSD_ENC_FILTERLEN (16) long.
@@ -86,28 +86,20 @@ static float float_conv_enc(float const *fp1, float const *fp2)
      * fp2 should be one of the enc_filter_xx_y() tables listed
      * in cvsdfilt.h.  At minimum, fp2 must be CVSD_ENC_FILTERLEN
      * (16) entries long.
+     *
+     * Four independent partial sums are kept so that the products
+     * can be accumulated in parallel (or as one SIMD vector).
      */
-    float res = 0;
-
-    /* unrolling loop */ 
-    res += fp1[0] * fp2[0];
-    res += fp1[1] * fp2[1];
-    res += fp1[2] * fp2[2];
-    res += fp1[3] * fp2[3];
-    res += fp1[4] * fp2[4];
-    res += fp1[5] * fp2[5];
-    res += fp1[6] * fp2[6];
-    res += fp1[7] * fp2[7];
-    res += fp1[8] * fp2[8];
-    res += fp1[9] * fp2[9];
-    res += fp1[10] * fp2[10];
-    res += fp1[11] * fp2[11];
-    res += fp1[12] * fp2[12];
-    res += fp1[13] * fp2[13];
-    res += fp1[14] * fp2[14];
-    res += fp1[15] * fp2[15];
-
-    return res;
+    float res0 = 0, res1 = 0, res2 = 0, res3 = 0;
+    int i;
+
+    for (i = 0; i < CVSD_ENC_FILTERLEN; i += 4) {
+        res0 += fp1[i + 0] * fp2[i + 0];
+        res1 += fp1[i + 1] * fp2[i + 1];
+        res2 += fp1[i + 2] * fp2[i + 2];
+        res3 += fp1[i + 3] * fp2[i + 3];
+    }
+    return (res0 + res1) + (res2 + res3);
 }
 
 static float float_conv_dec(float const *fp1, float const *fp2)
@@ -124,37 +116,25 @@ static float float_conv_dec(float const *fp1, float const *fp2)
      * (48) entries long, is assumed to have 0.0 in the last
      * entry, and is a symmetrical mirror around fp2[23] (ie,
      * fp2[22] == fp2[24], fp2[0] == fp2[47], etc).
+     *
+     * As in float_conv_enc(), four partial sums are kept.
      */
-    float res = 0;
-
-    /* unrolling loop, also taking advantage of the symmetry
-    * of the sampling rate array*/
-    res += (fp1[0] + fp1[46]) * fp2[0];
-    res += (fp1[1] + fp1[45]) * fp2[1];
-    res += (fp1[2] + fp1[44]) * fp2[2];
-    res += (fp1[3] + fp1[43]) * fp2[3];
-    res += (fp1[4] + fp1[42]) * fp2[4];
-    res += (fp1[5] + fp1[41]) * fp2[5];
-    res += (fp1[6] + fp1[40]) * fp2[6];
-    res += (fp1[7] + fp1[39]) * fp2[7];
-    res += (fp1[8] + fp1[38]) * fp2[8];
-    res += (fp1[9] + fp1[37]) * fp2[9];
-    res += (fp1[10] + fp1[36]) * fp2[10];
-    res += (fp1[11] + fp1[35]) * fp2[11];
-    res += (fp1[12] + fp1[34]) * fp2[12];
-    res += (fp1[13] + fp1[33]) * fp2[13];
-    res += (fp1[14] + fp1[32]) * fp2[14];
-    res += (fp1[15] + fp1[31]) * fp2[15];
-    res += (fp1[16] + fp1[30]) * fp2[16];
-    res += (fp1[17] + fp1[29]) * fp2[17];
-    res += (fp1[18] + fp1[28]) * fp2[18];
-    res += (fp1[19] + fp1[27]) * fp2[19];
-    res += (fp1[20] + fp1[26]) * fp2[20];
-    res += (fp1[21] + fp1[25]) * fp2[21];
-    res += (fp1[22] + fp1[24]) * fp2[22];
-    res += (fp1[23]) * fp2[23];
-
-    return res;
+    float res0 = 0, res1 = 0, res2 = 0, res3 = 0;
+    int i;
+
+    /* taking advantage of the symmetry of the sampling rate array */
+    for (i = 0; i < 20; i += 4) {
+        res0 += (fp1[i + 0] + fp1[46 - i]) * fp2[i + 0];
+        res1 += (fp1[i + 1] + fp1[45 - i]) * fp2[i + 1];
+        res2 += (fp1[i + 2] + fp1[44 - i]) * fp2[i + 2];
+        res3 += (fp1[i + 3] + fp1[43 - i]) * fp2[i + 3];
+    }
+    res0 += (fp1[20] + fp1[26]) * fp2[20];
+    res1 += (fp1[21] + fp1[25]) * fp2[21];
+    res2 += (fp1[22] + fp1[24]) * fp2[22];
+    res3 += (fp1[23]) * fp2[23];
+
+    return (res0 + res1) + (res2 + res3);
 }
 
 /* ---------------------------------------------------------------------- */
@@ -270,6 +250,7 @@ int lsx_cvsdstopwrite(sox_format_t * ft)
         }
         lsx_debug("cvsd: min slope %f, max slope %f",
                p->com.v_min, p->com.v_max);
+        free(p->bytes);
 
         return (SOX_SUCCESS);
 }
@@ -282,6 +263,7 @@ int lsx_cvsdstopread(sox_format_t * ft)
 
         lsx_debug("cvsd: min value %f, max value %f",
                p->com.v_min, p->com.v_max);
+        free(p->bytes);
 
         return(SOX_SUCCESS);
 }
@@ -291,13 +273,25 @@ int lsx_cvsdstopread(sox_format_t * ft)
 size_t lsx_cvsdread(sox_format_t * ft, sox_sample_t *buf, size_t nsamp)
 {
         priv_t *p = (priv_t *) ft->priv;
-        size_t done = 0;
+        size_t done = 0, nbits, nbytes = 0, i = 0;
         float oval;
 
+        /* Read in one go the bytes holding the bits that produce nsamp
+         * samples; but no more, so the stream position is as if they had
+         * been read one at a time. */
+        nbits = !nsamp? 0 :
+                (4 * nsamp - p->com.phase + p->com.phase_inc - 1) / p->com.phase_inc;
+        if (nbits > p->bit.cnt)
+                nbytes = (nbits - p->bit.cnt + 7) / 8;
+        if (nbytes > p->bytes_size)
+                p->bytes = lsx_realloc(p->bytes, p->bytes_size = nbytes);
+        nbytes = lsx_read_b_buf(ft, p->bytes, nbytes);
+
         while (done < nsamp) {
                 if (!p->bit.cnt) {
-                        if (lsx_read_b_buf(ft, &(p->bit.shreg), (size_t) 1) != 1)
-                                return done;
+                        if (i == nbytes)
+                                break;
+                        p->bit.shreg = p->bytes[i++];
                         p->bit.cnt = 8;
                         p->bit.mask = 1;
                 }
@@ -358,16 +352,21 @@ size_t lsx_cvsdread(sox_format_t * ft, sox_sample_t *buf, size_t nsamp)
 size_t lsx_cvsdwrite(sox_format_t * ft, const sox_sample_t *buf, size_t nsamp)
 {
         priv_t *p = (priv_t *) ft->priv;
-        size_t done = 0;
+        size_t done = 0, nbytes = (4 * nsamp / p->com.phase_inc + 16) / 8;
         float inval;
 
+        /* Completed bytes are collected in p->bytes and written in one go */
+        if (nbytes > p->bytes_size)
+                p->bytes = lsx_realloc(p->bytes, p->bytes_size = nbytes);
+        nbytes = 0;
+
         for(;;) {
                 /*
                  * check if the next input is due
                  */
                 if (p->com.phase >= 4) {
                         if (done >= nsamp)
-                                return done;
+                                break;
 
                         /* shift input filter window in mirror cirular buffer. */
                         if (p->c.enc.offset != 0)
@@ -407,7 +406,7 @@ size_t lsx_cvsdwrite(sox_format_t * ft, const sox_sample_t *buf, size_t nsamp)
                 } else
                         p->c.enc.recon_int -= p->com.mla_int;
                 if ((++(p->bit.cnt)) >= 8) {
-                        lsx_writeb(ft, p->bit.shreg);
+                        p->bytes[nbytes++] = p->bit.shreg;
                         p->bytes_written++;
                         p->bit.shreg = p->bit.cnt = 0;
                         p->bit.mask = 1;
@@ -418,6 +417,8 @@ size_t lsx_cvsdwrite(sox_format_t * ft, const sox_sample_t *buf, size_t nsamp)
                 lsx_debug_more("recon %d %f\n", debug_count, p->c.enc.recon_int);
                 debug_count++;
         }
+        lsx_writebuf(ft, p->bytes, nbytes);
+        return done;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -54,6 +54,8 @@ typedef struct {
   } bit;
   unsigned bytes_written;
   unsigned cvsd_rate;
+  unsigned char * bytes;   /* Bytes being read or written; grows as needed */
+  size_t bytes_size;
 } cvsd_priv_t;
 
 int lsx_cvsdstartread(sox_format_t * ft);
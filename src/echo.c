@@ -52,9 +52,8 @@
 
 /* Private data for SKEL file */
 typedef struct {
-        int     counter;
         int     num_delays;
-        double  *delay_buf;
+        lsx_delay_line_t delay_buf;
         float   in_gain, out_gain;
         float   delay[MAX_ECHOS], decay[MAX_ECHOS];
         ptrdiff_t samples[MAX_ECHOS], maxsamples;
@@ -101,7 +100,6 @@ static int sox_echo_start(sox_effect_t * effp)
         priv_t * echo = (priv_t *) effp->priv;
         int i;
         float sum_in_volume;
-        long j;
 
         echo->maxsamples = 0;
         if ( echo->in_gain < 0.0 )
@@ -145,53 +143,62 @@ static int sox_echo_start(sox_effect_t * effp)
                 if ( echo->samples[i] > echo->maxsamples )
                         echo->maxsamples = echo->samples[i];
         }
-        echo->delay_buf = lsx_malloc(sizeof (double) * echo->maxsamples);
-        for ( j = 0; j < echo->maxsamples; ++j )
-                echo->delay_buf[j] = 0.0;
+        lsx_delay_line_create(&echo->delay_buf, (size_t)echo->maxsamples);
         /* Be nice and check the hint with warning, if... */
         sum_in_volume = 1.0;
         for ( i = 0; i < echo->num_delays; i++ )
                 sum_in_volume += echo->decay[i];
         if ( sum_in_volume * echo->in_gain > 1.0 / echo->out_gain )
                 lsx_warn("echo: warning >>> gain-out can cause saturation of output <<<");
-        echo->counter = 0;
         echo->fade_out = echo->maxsamples;
         return (SOX_SUCCESS);
 }
 
 /*
- * Processed signed long samples from ibuf to obuf.
- * Return number of samples processed.
+ * Process len samples from ibuf (or silence, if NULL) to obuf.
  */
-static int sox_echo_flow(sox_effect_t * effp, const sox_sample_t *ibuf, sox_sample_t *obuf,
-                 size_t *isamp, size_t *osamp)
+static void sox_echo(sox_effect_t * effp, const sox_sample_t *ibuf, sox_sample_t *obuf,
+                 size_t len)
 {
         priv_t * echo = (priv_t *) effp->priv;
         int j;
-        double d_in, d_out;
-        sox_sample_t out;
-        size_t len = min(*isamp, *osamp);
-        *isamp = *osamp = len;
+        double d_out[LSX_DELAY_LINE_BLOCK_LEN];
+        size_t i, n;
 
-        while (len--) {
+        for (; len; len -= n) {
                 /* Store delays as 24-bit signed longs */
-                d_in = (double) *ibuf++ / 256;
-                /* Compute output first */
-                d_out = d_in * echo->in_gain;
+                double * d_in = lsx_delay_line_write(&echo->delay_buf,
+                        n = min(len, array_length(d_out)));
+                for ( i = 0; i < n; i++ ) {
+                        d_in[i] = ibuf? (double) *ibuf++ / 256 : 0;
+                        d_out[i] = d_in[i] * echo->in_gain;
+                }
+                /* Mix in the delays, each over the whole block */
                 for ( j = 0; j < echo->num_delays; j++ ) {
-                        d_out += echo->delay_buf[
-(echo->counter + echo->maxsamples - echo->samples[j]) % echo->maxsamples]
-                        * echo->decay[j];
+                        double const * delayed = d_in - echo->samples[j];
+                        double decay = echo->decay[j];
+                        for ( i = 0; i < n; i++ )
+                                d_out[i] += delayed[i] * decay;
+                }
+                for ( i = 0; i < n; i++ ) {
+                        /* Adjust the output volume and size to 24 bit */
+                        double out = d_out[i] * echo->out_gain;
+                        *obuf++ = SOX_24BIT_CLIP_COUNT((sox_sample_t) out, effp->clips) * 256;
                 }
-                /* Adjust the output volume and size to 24 bit */
-                d_out = d_out * echo->out_gain;
-                out = SOX_24BIT_CLIP_COUNT((sox_sample_t) d_out, effp->clips);
-                *obuf++ = out * 256;
-                /* Store input in delay buffer */
-                echo->delay_buf[echo->counter] = d_in;
-                /* Adjust the counter */
-                echo->counter = ( echo->counter + 1 ) % echo->maxsamples;
         }
+}
+
+/*
+ * Processed signed long samples from ibuf to obuf.
+ * Return number of samples processed.
+ */
+static int sox_echo_flow(sox_effect_t * effp, const sox_sample_t *ibuf, sox_sample_t *obuf,
+                 size_t *isamp, size_t *osamp)
+{
+        size_t len = min(*isamp, *osamp);
+        *isamp = *osamp = len;
+
+        sox_echo(effp, ibuf, obuf, len);
         /* processed all samples */
         return (SOX_SUCCESS);
 }
@@ -202,32 +209,11 @@ static int sox_echo_flow(sox_effect_t * effp, const sox_sample_t *ibuf, sox_samp
 static int sox_echo_drain(sox_effect_t * effp, sox_sample_t *obuf, size_t *osamp)
 {
         priv_t * echo = (priv_t *) effp->priv;
-        double d_in, d_out;
-        sox_sample_t out;
-        int j;
-        size_t done;
+        size_t done = min(*osamp, echo->fade_out);
 
-        done = 0;
         /* drain out delay samples */
-        while ( ( done < *osamp ) && ( done < echo->fade_out ) ) {
-                d_in = 0;
-                d_out = 0;
-                for ( j = 0; j < echo->num_delays; j++ ) {
-                        d_out += echo->delay_buf[
-(echo->counter + echo->maxsamples - echo->samples[j]) % echo->maxsamples]
-                        * echo->decay[j];
-                }
-                /* Adjust the output volume and size to 24 bit */
-                d_out = d_out * echo->out_gain;
-                out = SOX_24BIT_CLIP_COUNT((sox_sample_t) d_out, effp->clips);
-                *obuf++ = out * 256;
-                /* Store input in delay buffer */
-                echo->delay_buf[echo->counter] = d_in;
-                /* Adjust the counters */
-                echo->counter = ( echo->counter + 1 ) % echo->maxsamples;
-                done++;
-                echo->fade_out--;
-        };
+        sox_echo(effp, NULL, obuf, done);
+        echo->fade_out -= done;
         /* samples played, it remains */
         *osamp = done;
         if (echo->fade_out == 0)
@@ -240,8 +226,7 @@ static int sox_echo_stop(sox_effect_t * effp)
 {
         priv_t * echo = (priv_t *) effp->priv;
 
-        free(echo->delay_buf);
-        echo->delay_buf = NULL;
+        lsx_delay_line_delete(&echo->delay_buf);
         return (SOX_SUCCESS);
 }
 
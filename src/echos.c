@@ -48,13 +48,13 @@
 
 /* Private data for SKEL file */
 typedef struct {
-        int     counter[MAX_ECHOS];
         int     num_delays;
-        double  *delay_buf;
+        lsx_delay_line_t delay_buf;
         float   in_gain, out_gain;
         float   delay[MAX_ECHOS], decay[MAX_ECHOS];
-        ptrdiff_t samples[MAX_ECHOS], pointer[MAX_ECHOS];
-        size_t sumsamples;
+        double  tap_gain[MAX_ECHOS];
+        ptrdiff_t samples[MAX_ECHOS], maxsamples;
+        size_t fade_out;
 } priv_t;
 
 /* Private data for SKEL file */
@@ -88,7 +88,6 @@ static int sox_echos_getopts(sox_effect_t * effp, int argc, char **argv)
                         return (SOX_EOF);
                 }
         }
-        echos->sumsamples = 0;
         return (SOX_SUCCESS);
 }
 
@@ -100,8 +99,9 @@ static int sox_echos_start(sox_effect_t * effp)
         priv_t * echos = (priv_t *) effp->priv;
         int i;
         float sum_in_volume;
-        unsigned long j;
+        size_t sumsamples = 0;
 
+        echos->maxsamples = 0;
         if ( echos->in_gain < 0.0 )
         {
                 lsx_fail("echos: gain-in must be positive!");
@@ -140,13 +140,15 @@ static int sox_echos_start(sox_effect_t * effp)
                     lsx_fail("echos: decay must be less than 1.0!" );
                     return (SOX_EOF);
                 }
-                echos->counter[i] = 0;
-                echos->pointer[i] = echos->sumsamples;
-                echos->sumsamples += echos->samples[i];
+                /* Delay i is fed with the input plus what has just been fed
+                 * to delay i - 1, i.e. i + 1 times the input, so it amounts to
+                 * a tap, i + 1 times as loud, on a single delay line: */
+                echos->tap_gain[i] = (double)echos->decay[i] * (i + 1);
+                echos->maxsamples = max(echos->maxsamples, echos->samples[i]);
+                sumsamples += echos->samples[i];
         }
-        echos->delay_buf = lsx_malloc(sizeof (double) * echos->sumsamples);
-        for ( j = 0; j < echos->sumsamples; ++j )
-                echos->delay_buf[j] = 0.0;
+        lsx_delay_line_create(&echos->delay_buf, (size_t)echos->maxsamples);
+        echos->fade_out = sumsamples;
         /* Be nice and check the hint with warning, if... */
         sum_in_volume = 1.0;
         for ( i = 0; i < echos->num_delays; i++ )
@@ -157,44 +159,50 @@ static int sox_echos_start(sox_effect_t * effp)
 }
 
 /*
- * Processed signed long samples from ibuf to obuf.
- * Return number of samples processed.
+ * Process len samples from ibuf (or silence, if NULL) to obuf.
  */
-static int sox_echos_flow(sox_effect_t * effp, const sox_sample_t *ibuf, sox_sample_t *obuf,
-                size_t *isamp, size_t *osamp)
+static void sox_echos(sox_effect_t * effp, const sox_sample_t *ibuf, sox_sample_t *obuf,
+                size_t len)
 {
         priv_t * echos = (priv_t *) effp->priv;
         int j;
-        double d_in, d_out;
-        sox_sample_t out;
-        size_t len = min(*isamp, *osamp);
-        *isamp = *osamp = len;
+        double d_out[LSX_DELAY_LINE_BLOCK_LEN];
+        size_t i, n;
 
-        while (len--) {
+        for (; len; len -= n) {
                 /* Store delays as 24-bit signed longs */
-                d_in = (double) *ibuf++ / 256;
-                /* Compute output first */
-                d_out = d_in * echos->in_gain;
-                for ( j = 0; j < echos->num_delays; j++ ) {
-                        d_out += echos->delay_buf[echos->counter[j] + echos->pointer[j]] * echos->decay[j];
+                double * d_in = lsx_delay_line_write(&echos->delay_buf,
+                        n = min(len, array_length(d_out)));
+                for ( i = 0; i < n; i++ ) {
+                        d_in[i] = ibuf? (double) *ibuf++ / 256 : 0;
+                        d_out[i] = d_in[i] * echos->in_gain;
                 }
-                /* Adjust the output volume and size to 24 bit */
-                d_out = d_out * echos->out_gain;
-                out = SOX_24BIT_CLIP_COUNT((sox_sample_t) d_out, effp->clips);
-                *obuf++ = out * 256;
-                /* Mix decay of delays and input */
+                /* Mix in the delays, each over the whole block */
                 for ( j = 0; j < echos->num_delays; j++ ) {
-                        if ( j == 0 )
-                                echos->delay_buf[echos->counter[j] + echos->pointer[j]] = d_in;
-                        else
-                                echos->delay_buf[echos->counter[j] + echos->pointer[j]] =
-                                   echos->delay_buf[echos->counter[j-1] + echos->pointer[j-1]] + d_in;
+                        double const * delayed = d_in - echos->samples[j];
+                        double gain = echos->tap_gain[j];
+                        for ( i = 0; i < n; i++ )
+                                d_out[i] += delayed[i] * gain;
+                }
+                for ( i = 0; i < n; i++ ) {
+                        /* Adjust the output volume and size to 24 bit */
+                        double out = d_out[i] * echos->out_gain;
+                        *obuf++ = SOX_24BIT_CLIP_COUNT((sox_sample_t) out, effp->clips) * 256;
                 }
-                /* Adjust the counters */
-                for ( j = 0; j < echos->num_delays; j++ )
-                        echos->counter[j] =
-                           ( echos->counter[j] + 1 ) % echos->samples[j];
         }
+}
+
+/*
+ * Processed signed long samples from ibuf to obuf.
+ * Return number of samples processed.
+ */
+static int sox_echos_flow(sox_effect_t * effp, const sox_sample_t *ibuf, sox_sample_t *obuf,
+                size_t *isamp, size_t *osamp)
+{
+        size_t len = min(*isamp, *osamp);
+        *isamp = *osamp = len;
+
+        sox_echos(effp, ibuf, obuf, len);
         /* processed all samples */
         return (SOX_SUCCESS);
 }
@@ -205,41 +213,14 @@ static int sox_echos_flow(sox_effect_t * effp, const sox_sample_t *ibuf, sox_sam
 static int sox_echos_drain(sox_effect_t * effp, sox_sample_t *obuf, size_t *osamp)
 {
         priv_t * echos = (priv_t *) effp->priv;
-        double d_in, d_out;
-        sox_sample_t out;
-        int j;
-        size_t done;
+        size_t done = min(*osamp, echos->fade_out);
 
-        done = 0;
         /* drain out delay samples */
-        while ( ( done < *osamp ) && ( done < echos->sumsamples ) ) {
-                d_in = 0;
-                d_out = 0;
-                for ( j = 0; j < echos->num_delays; j++ ) {
-                        d_out += echos->delay_buf[echos->counter[j] + echos->pointer[j]] * echos->decay[j];
-                }
-                /* Adjust the output volume and size to 24 bit */
-                d_out = d_out * echos->out_gain;
-                out = SOX_24BIT_CLIP_COUNT((sox_sample_t) d_out, effp->clips);
-                *obuf++ = out * 256;
-                /* Mix decay of delays and input */
-                for ( j = 0; j < echos->num_delays; j++ ) {
-                        if ( j == 0 )
-                                echos->delay_buf[echos->counter[j] + echos->pointer[j]] = d_in;
-                        else
-                                echos->delay_buf[echos->counter[j] + echos->pointer[j]] =
-                                   echos->delay_buf[echos->counter[j-1] + echos->pointer[j-1]];
-                }
-                /* Adjust the counters */
-                for ( j = 0; j < echos->num_delays; j++ )
-                        echos->counter[j] =
-                           ( echos->counter[j] + 1 ) % echos->samples[j];
-                done++;
-                echos->sumsamples--;
-        };
+        sox_echos(effp, NULL, obuf, done);
+        echos->fade_out -= done;
         /* samples played, it remains */
         *osamp = done;
-        if (echos->sumsamples == 0)
+        if (echos->fade_out == 0)
             return SOX_EOF;
         else
             return SOX_SUCCESS;
@@ -252,8 +233,7 @@ static int sox_echos_stop(sox_effect_t * effp)
 {
         priv_t * echos = (priv_t *) effp->priv;
 
-        free(echos->delay_buf);
-        echos->delay_buf = NULL;
+        lsx_delay_line_delete(&echos->delay_buf);
         return (SOX_SUCCESS);
 }
 
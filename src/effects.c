@@ -172,6 +172,17 @@ int sox_add_effect(sox_effects_chain_t * chain, sox_effect_t * effp, sox_signali
 
   *in = effp->out_signal;
 
+  if (chain->length && lsx_biquad_fuse(chain->effects[chain->length - 1], effp)) {
+    lsx_report("fused with the preceding `%s'",
+        chain->effects[chain->length - 1][0].handler.name);
+    /* effp is not added to the chain, so nothing else owns its priv (whose
+     * resources lsx_biquad_fuse has released): */
+    free(effp->priv);
+    effp->priv = NULL;
+    free(eff0.priv);
+    return SOX_SUCCESS;
+  }
+
   if (chain->length == SOX_MAX_EFFECTS) {
     lsx_fail("Too many effects!");
     free(eff0.priv);
@@ -47,6 +47,112 @@ char * lsx_usage_lines(char * * usage, char const * const * lines, size_t n)
   return *usage;
 }
 
+/* For effects that are given their input file to read themselves: whether
+ * the file can be seeked to any sample exactly. */
+sox_bool lsx_is_seek_exact(sox_format_t const * ft)
+{
+  if (!ft->handler.seek || !ft->seekable)
+    return sox_false;
+  switch (ft->encoding.encoding) {
+    case SOX_ENCODING_SIGN2: case SOX_ENCODING_UNSIGNED:
+    case SOX_ENCODING_FLOAT: case SOX_ENCODING_ULAW: case SOX_ENCODING_ALAW:
+      return sox_true;
+    default: return sox_false;
+  }
+}
+
+/* Sample storage for effects that must hold on to their input: */
+
+static void pack(void * dest, sox_sample_t const * s, size_t len, unsigned bytes)
+{
+  unsigned char * d = dest;
+  switch (bytes) {
+    case 1: while (len--) *d++ = (uint32_t)*s++ >> 24; break;
+    case 2: {
+      int16_t * d16 = dest;
+      while (len--) *d16++ = *s++ >> 16;
+      break;
+    }
+    case 3: for (; len; --len, ++s, d += 3) {
+      d[0] = (uint32_t)*s >> 8, d[1] = (uint32_t)*s >> 16, d[2] = (uint32_t)*s >> 24;
+    }
+    break;
+    default: memcpy(dest, s, len * sizeof(*s)); break;
+  }
+}
+
+/* Expands packed samples; src may be in the end part of s's buffer */
+static void unpack(sox_sample_t * s, void const * src, size_t len, unsigned bytes)
+{
+  unsigned char const * d = src;
+  switch (bytes) {
+    case 1: for (; len; --len) *s++ = (uint32_t)*d++ << 24; break;
+    case 2: {
+      int16_t const * d16 = (int16_t const *)d;
+      for (; len; --len) *s++ = (uint32_t)*d16++ << 16;
+      break;
+    }
+    case 3: for (; len; --len, d += 3)
+      *s++ = (uint32_t)d[0] << 8 | (uint32_t)d[1] << 16 | (uint32_t)d[2] << 24;
+    break;
+    default: memmove(s, src, len * sizeof(*s)); break;
+  }
+}
+
+void lsx_tmpsamples_init(lsx_tmpsamples_t * t, unsigned precision)
+{
+  memset(t, 0, sizeof(*t));
+  t->bytes = precision && precision < 32? (precision + 7) / 8 : 4;
+}
+
+/* If any sample has more precision than expected, what is held already is
+ * first widened to full precision. */
+int lsx_tmpsamples_write(lsx_tmpsamples_t * t, sox_sample_t const * s, size_t len)
+{
+  size_t i;
+  sox_sample_t bits = 0;
+  void * data;
+  int result;
+
+  for (i = 0; i < len; ++i)
+    bits |= s[i];
+  if (t->bytes < 4 && (bits & ((1u << (32 - 8 * t->bytes)) - 1))) {
+    lsx_tmpbuf_t tmp;
+    sox_sample_t buf[4096];
+    char * packed = (char *)(buf + array_length(buf)) - t->bytes * array_length(buf);
+    uint64_t pos;
+    size_t n;
+
+    memset(&tmp, 0, sizeof(tmp));
+    for (pos = 0; pos < t->tmp.length; pos += n) {
+      n = lsx_tmpbuf_read(&t->tmp, pos, packed, t->bytes * array_length(buf));
+      unpack(buf, packed, n / t->bytes, t->bytes);
+      if (!n || lsx_tmpbuf_write(&tmp, buf, n / t->bytes * sizeof(*buf)) != SOX_SUCCESS) {
+        lsx_tmpbuf_close(&tmp);
+        return SOX_EOF;
+      }
+    }
+    lsx_tmpbuf_close(&t->tmp);
+    t->tmp = tmp;
+    t->bytes = 4;
+  }
+  if (t->bytes == 4)
+    return lsx_tmpbuf_write(&t->tmp, s, len * sizeof(*s));
+  data = lsx_malloc(len * t->bytes + !len);
+  pack(data, s, len, t->bytes);
+  result = lsx_tmpbuf_write(&t->tmp, data, len * t->bytes);
+  free(data);
+  return result;
+}
+
+size_t lsx_tmpsamples_read(lsx_tmpsamples_t * t, uint64_t pos, sox_sample_t * s, size_t len)
+{
+  char * packed = (char *)(s + len) - len * t->bytes;
+  len = lsx_tmpbuf_read(&t->tmp, pos * t->bytes, packed, len * t->bytes) / t->bytes;
+  unpack(s, packed, len, t->bytes);
+  return len;
+}
+
 lsx_enum_item const lsx_wave_enum[] = {
   LSX_ENUM_ITEM(SOX_WAVE_,SINE)
   LSX_ENUM_ITEM(SOX_WAVE_,TRIANGLE)
@@ -129,6 +235,48 @@ void lsx_generate_wave_table(
   }
 }
 
+void lsx_read_wave_table(
+    sox_data_t data_type,
+    void const * table,
+    size_t table_size,
+    size_t * phase,
+    void * buf,
+    size_t n)
+{
+  size_t bytes = data_type == SOX_SHORT? sizeof(short) :
+    data_type == SOX_INT? sizeof(int) : data_type == SOX_FLOAT?
+    sizeof(float) : sizeof(double);
+  char * b = buf;
+
+  while (n) {
+    size_t k = min(n, table_size - *phase);
+    memcpy(b, (char const *)table + *phase * bytes, k * bytes);
+    b += k * bytes, n -= k;
+    *phase = (*phase + k) % table_size;
+  }
+}
+
+void lsx_delay_line_create(lsx_delay_line_t * p, size_t max_delay)
+{
+  p->max_delay = max_delay;
+  p->block_len = max(max_delay, LSX_DELAY_LINE_BLOCK_LEN);
+  p->pos = 0;
+  p->buf = lsx_calloc(max_delay + p->block_len, sizeof(*p->buf));
+}
+
+double * lsx_delay_line_write(lsx_delay_line_t * p, size_t n)
+{
+  double * x;
+
+  if (p->pos + n > p->block_len) { /* Move the history to the front */
+    memmove(p->buf, p->buf + p->pos, p->max_delay * sizeof(*p->buf));
+    p->pos = 0;
+  }
+  x = p->buf + p->max_delay + p->pos;
+  p->pos += n;
+  return x;
+}
+
 /*
  * lsx_parsesamples
  *
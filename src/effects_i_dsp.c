@@ -183,6 +183,81 @@ void lsx_power_spectrum_f(int n, float const * in, float * out)
   free(work);
 }
 
+/* Cost (in multiply-adds, roughly) of 3 real DFTs of length n: */
+#define DFT_COST(n) (3 * (n) * (log((double)(n)) / log(2.) + 1))
+
+/* For a least-squares overlap search (see lsx_best_overlap_dft), returns
+ * the DFT length to use, or 0 if a direct search would be cheaper. */
+int lsx_overlap_dft_len(size_t n, size_t search, size_t stride)
+{
+  size_t len = stride * (search - 1) + n, dft_len = 2;
+
+  if (search < 2 || len > (size_t)1 << 30)
+    return 0;
+  while (dft_len < len)
+    dft_len <<= 1;
+  return DFT_COST(dft_len) < (double)search * n? (int)dft_len : 0;
+}
+
+/* Returns i, 0 <= i < search, for which sum((x[stride * i + k] - y[k])^2),
+ * 0 <= k < n, is least.  The sum is expanded as x-energy - 2 cross-correlation
+ * (+ constant y-energy); all the cross-correlations are found together by DFT.
+ * DFT rounding can reorder sums that are (nearly) equal, as on periodic input,
+ * so if a difference function is given, the positions whose sums are within
+ * rounding error of the least are re-checked with it; then, as with a direct
+ * search, the first position of least difference is returned.
+ * x holds stride * (search - 1) + n samples but has room for dft_len + search;
+ * y holds n samples but has room for dft_len.  Both are overwritten. */
+size_t lsx_best_overlap_dft(int dft_len, double * x, double * y,
+    size_t n, size_t search, size_t stride,
+    lsx_overlap_difference_t difference, void * data)
+{
+  size_t i, k, len = stride * (search - 1) + n, best_pos = 0;
+  double * diffs = x + dft_len, e = 0, e_max, y_e = 0, least_diff, threshold;
+
+  for (k = 0; k < n; ++k)
+    e += sqr(x[k]), y_e += sqr(y[k]);
+  for (diffs[0] = e_max = e, i = 1; i < search; diffs[i++] = e) {
+    for (k = 0; k < stride; ++k)
+      e += sqr(x[stride * (i - 1) + n + k]) - sqr(x[stride * (i - 1) + k]);
+    e_max = max(e_max, e);
+  }
+
+  memset(x + len, 0, (dft_len - len) * sizeof(*x));
+  memset(y + n, 0, (dft_len - n) * sizeof(*y));
+  lsx_safe_rdft(dft_len, 1, x);
+  lsx_safe_rdft(dft_len, 1, y);
+  x[0] *= y[0];
+  x[1] *= y[1];
+  for (k = 2; k < (size_t)dft_len; k += 2) { /* x *= conj(y) */
+    double tmp = x[k];
+    x[k  ] = tmp * y[k] + x[k+1] * y[k+1];
+    x[k+1] = x[k+1] * y[k] - tmp * y[k+1];
+  }
+  lsx_safe_rdft(dft_len, -1, x);  /* x[j] is now (dft_len / 2) x correlation */
+
+  for (i = 0; i < search; ++i) {  /* diffs[i] is now sum - y-energy */
+    diffs[i] -= 4. / dft_len * x[stride * i];
+    if (diffs[i] < diffs[best_pos])
+      best_pos = i;
+  }
+  if (!difference)
+    return best_pos;
+
+  /* Allow for rounding in the DFT and in the caller's (maybe single
+   * precision) sums: */
+  least_diff = diffs[best_pos];
+  threshold = least_diff +
+    1e-9 * (e_max + y_e) + 2e-7 * n * max(least_diff + y_e, 0);
+  for (least_diff = HUGE_VAL, i = 0; i < search && least_diff > 0; ++i)
+    if (diffs[i] <= threshold) {
+      double diff = (*difference)(data, i);
+      if (diff < least_diff)
+        least_diff = diff, best_pos = i;
+    }
+  return best_pos;
+}
+
 void lsx_apply_hann_f(float h[], const int num_points)
 {
   int i, m = num_points - 1;
@@ -47,8 +47,9 @@ typedef struct {
   unsigned sample_rate;
   unsigned total_samples;
 
-  /* Decode buffer: */
-  FLAC__int32 const * const * decoded_wide_samples;
+  /* Decode buffer: the last frame decoded, converted and interleaved */
+  sox_sample_t * decoded_wide_samples;
+  unsigned max_wide_samples;    /* allocated size of decoded_wide_samples */
   unsigned number_of_wide_samples;
   unsigned wide_sample_number;
 
@@ -114,6 +115,8 @@ static FLAC__StreamDecoderWriteStatus FLAC__frame_decode_callback(FLAC__StreamDe
 {
   sox_format_t * ft = (sox_format_t *) client_data;
   priv_t * p = (priv_t *)ft->priv;
+  unsigned blocksize = frame->header.blocksize, shift = 32 - p->bits_per_sample;
+  unsigned channel, i;
 
   (void) flac;
 
@@ -122,9 +125,29 @@ static FLAC__StreamDecoderWriteStatus FLAC__frame_decode_callback(FLAC__StreamDe
     return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
   }
 
-  /* FIXME: We're skating on thin ice here: buffer may be on the stack! */
-  p->decoded_wide_samples = buffer;
-  p->number_of_wide_samples = frame->header.blocksize;
+  if (blocksize > p->max_wide_samples) {
+    p->max_wide_samples = blocksize;
+    p->decoded_wide_samples = lsx_realloc(p->decoded_wide_samples,
+        blocksize * p->channels * sizeof(*p->decoded_wide_samples));
+  }
+
+  /* Convert the whole frame now, whilst buffer is valid; a left shift of
+   * the sample to the top of sox_sample_t serves all bit depths. */
+  if (p->channels == 2) {
+    FLAC__int32 const * left = buffer[0], * right = buffer[1];
+    sox_sample_t * dest = p->decoded_wide_samples;
+    for (i = 0; i < blocksize; ++i) {
+      *dest++ = (sox_sample_t)left[i] << shift;
+      *dest++ = (sox_sample_t)right[i] << shift;
+    }
+  }
+  else for (channel = 0; channel < p->channels; ++channel) {
+    FLAC__int32 const * src = buffer[channel];
+    sox_sample_t * dest = p->decoded_wide_samples + channel;
+    for (i = 0; i < blocksize; ++i, dest += p->channels)
+      *dest = (sox_sample_t)src[i] << shift;
+  }
+  p->number_of_wide_samples = blocksize;
   p->wide_sample_number = 0;
   return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
 }
@@ -204,19 +227,16 @@ static size_t read_samples(sox_format_t * const ft, sox_sample_t * sampleBuffer,
       FLAC__stream_decoder_process_single(p->decoder);
     if (p->wide_sample_number >= p->number_of_wide_samples)
       p->eof = sox_true;
-    else { /* FIXME: this block should really be inside the decode callback */
-      unsigned channel;
-
-      for (channel = 0; channel < p->channels; channel++, actual++) {
-        FLAC__int32 d = p->decoded_wide_samples[channel][p->wide_sample_number];
-        switch (p->bits_per_sample) {
-        case  8: *sampleBuffer++ = SOX_SIGNED_8BIT_TO_SAMPLE(d,); break;
-        case 16: *sampleBuffer++ = SOX_SIGNED_16BIT_TO_SAMPLE(d,); break;
-        case 24: *sampleBuffer++ = SOX_SIGNED_24BIT_TO_SAMPLE(d,); break;
-        case 32: *sampleBuffer++ = SOX_SIGNED_32BIT_TO_SAMPLE(d,); break;
-        }
-      }
-      ++p->wide_sample_number;
+    else {
+      size_t n = min(p->number_of_wide_samples - p->wide_sample_number,
+                     (requested - actual) / p->channels);
+      if (!n)
+        break;
+      memcpy(sampleBuffer + actual,
+          p->decoded_wide_samples + p->wide_sample_number * p->channels,
+          n * p->channels * sizeof(*sampleBuffer));
+      p->wide_sample_number += n;
+      actual += n * p->channels;
     }
   }
   return actual;
@@ -230,6 +250,7 @@ static int stop_read(sox_format_t * const ft)
   if (!FLAC__stream_decoder_finish(p->decoder) && p->eof)
     lsx_warn("decoder MD5 checksum mismatch.");
   FLAC__stream_decoder_delete(p->decoder);
+  free(p->decoded_wide_samples);
   return SOX_SUCCESS;
 }
 
@@ -371,6 +392,18 @@ static int start_write(sox_format_t * const ft)
   }
 #endif
 
+#if FLAC_API_VERSION_CURRENT >= 14
+  { /* libFLAC 1.5 can encode groups of frames in parallel, itself stitching
+     * them together and fixing up STREAMINFO and SEEKTABLE: */
+    unsigned threads = omp_get_max_threads();
+    if (threads > 1) {
+      if (FLAC__stream_encoder_set_num_threads(p->encoder, threads) == FLAC__STREAM_ENCODER_SET_NUM_THREADS_OK)
+        lsx_report("encoding with %u threads", threads);
+      else lsx_report("libFLAC can't encode with %u threads", threads);
+    }
+  }
+#endif
+
   if (ft->signal.length != 0) {
     FLAC__stream_encoder_set_total_samples_estimate(p->encoder, (FLAC__uint64)(ft->signal.length / ft->signal.channels));
 
@@ -439,28 +472,22 @@ static int start_write(sox_format_t * const ft)
 static size_t write_samples(sox_format_t * const ft, sox_sample_t const * const sampleBuffer, size_t const len)
 {
   priv_t * p = (priv_t *)ft->priv;
-  unsigned i;
-
-  for (i = 0; i < len; ++i) {
-    SOX_SAMPLE_LOCALS;
-    long pcm = SOX_SAMPLE_TO_SIGNED_32BIT(sampleBuffer[i], ft->clips);
-    p->decoded_samples[i] = pcm >> (32 - p->bits_per_sample);
-    switch (p->bits_per_sample) {
-      case  8: p->decoded_samples[i] =
-          SOX_SAMPLE_TO_SIGNED_8BIT(sampleBuffer[i], ft->clips);
-        break;
-      case 16: p->decoded_samples[i] =
-          SOX_SAMPLE_TO_SIGNED_16BIT(sampleBuffer[i], ft->clips);
-        break;
-      case 24: p->decoded_samples[i] = /* sign extension: */
-          SOX_SAMPLE_TO_SIGNED_24BIT(sampleBuffer[i],ft->clips) << 8;
-        p->decoded_samples[i] >>= 8;
-        break;
-      case 32: p->decoded_samples[i] =
-          SOX_SAMPLE_TO_SIGNED_32BIT(sampleBuffer[i],ft->clips);
-        break;
-    }
+  FLAC__int32 * dest = p->decoded_samples;
+  size_t i;
+  SOX_SAMPLE_LOCALS;
+
+#define CONVERT(cast) for (i = 0; i < len; ++i) \
+    dest[i] = cast(sampleBuffer[i], ft->clips)
+#define SIGN_EXTENDED_24BIT(d,clips) /* int24_t has an extra byte */ \
+    (FLAC__int32)((FLAC__uint32)SOX_SAMPLE_TO_SIGNED_24BIT(d,clips) << 8) >> 8
+  switch (p->bits_per_sample) { /* once per call, not per sample */
+    case  8: CONVERT(SOX_SAMPLE_TO_SIGNED_8BIT); break;
+    case 16: CONVERT(SOX_SAMPLE_TO_SIGNED_16BIT); break;
+    case 24: CONVERT(SIGN_EXTENDED_24BIT); break;
+    case 32: CONVERT(SOX_SAMPLE_TO_SIGNED_32BIT); break;
   }
+#undef SIGN_EXTENDED_24BIT
+#undef CONVERT
   FLAC__stream_encoder_process_interleaved(p->encoder, p->decoded_samples, (unsigned) len / ft->signal.channels);
   return FLAC__stream_encoder_get_state(p->encoder) == FLAC__STREAM_ENCODER_OK ? len : 0;
 }
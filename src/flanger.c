@@ -35,10 +35,9 @@ typedef struct {
   double     channel_phase;
   interp_t   interpolation;
 
-  /* Delay buffers */
-  double *   delay_bufs[MAX_CHANNELS];
+  /* Delay lines */
+  lsx_delay_line_t delay_lines[MAX_CHANNELS];
   size_t  delay_buf_length;
-  size_t  delay_buf_pos;
   double     delay_last[MAX_CHANNELS];
 
   /* Low Frequency Oscillator */
@@ -134,13 +133,13 @@ static int start(sox_effect_t * effp)
   lsx_debug("in_gain=%g feedback_gain=%g delay_gain=%g\n",
       f->in_gain, f->feedback_gain, f->delay_gain);
 
-  /* Create the delay buffers, one for each channel: */
+  /* Create the delay lines, one for each channel: */
   f->delay_buf_length =
     (f->delay_min + f->delay_depth) * effp->in_signal.rate + 0.5;
   ++f->delay_buf_length;  /* Need 0 to n, i.e. n + 1. */
   ++f->delay_buf_length;  /* Quadratic interpolator needs one more. */
   for (c = 0; c < channels; ++c)
-    f->delay_bufs[c] = lsx_calloc(f->delay_buf_length, sizeof(*f->delay_bufs[0]));
+    lsx_delay_line_create(&f->delay_lines[c], f->delay_buf_length);
 
   /* Create the LFO lookup table: */
   f->lfo_length = effp->in_signal.rate / f->speed;
@@ -167,49 +166,54 @@ static int flow(sox_effect_t * effp, sox_sample_t const * ibuf,
 {
   priv_t * f = (priv_t *) effp->priv;
   int c, channels = effp->in_signal.channels;
-  size_t len = (*isamp > *osamp ? *osamp : *isamp) / channels;
+  size_t len = (*isamp > *osamp ? *osamp : *isamp) / channels, i, n;
+  float lfo[LSX_DELAY_LINE_BLOCK_LEN];
 
   *isamp = *osamp = len * channels;
 
-  while (len--) {
-    f->delay_buf_pos =
-      (f->delay_buf_pos + f->delay_buf_length - 1) % f->delay_buf_length;
+  for (; len; len -= n, ibuf += n * channels, obuf += n * channels) {
+    n = min(len, array_length(lfo));
     for (c = 0; c < channels; ++c) {
-      double delayed_0, delayed_1;
-      double delayed;
-      double in, out;
-      size_t channel_phase = c * f->lfo_length * f->channel_phase + .5;
-      double delay = f->lfo[(f->lfo_pos + channel_phase) % f->lfo_length];
-      double frac_delay = modf(delay, &delay);
-      size_t int_delay = (size_t)delay;
-
-      in = *ibuf++;
-      f->delay_bufs[c][f->delay_buf_pos] = in + f->delay_last[c] * f->feedback_gain;
-
-      delayed_0 = f->delay_bufs[c]
-        [(f->delay_buf_pos + int_delay++) % f->delay_buf_length];
-      delayed_1 = f->delay_bufs[c]
-        [(f->delay_buf_pos + int_delay++) % f->delay_buf_length];
-
-      if (f->interpolation == INTERP_LINEAR)
-        delayed = delayed_0 + (delayed_1 - delayed_0) * frac_delay;
-      else /* if (f->interpolation == INTERP_QUADRATIC) */
-      {
-        double a, b;
-        double delayed_2 = f->delay_bufs[c]
-          [(f->delay_buf_pos + int_delay++) % f->delay_buf_length];
-        delayed_2 -= delayed_0;
-        delayed_1 -= delayed_0;
-        a = delayed_2 *.5 - delayed_1;
-        b = delayed_1 * 2 - delayed_2 *.5;
-        delayed = delayed_0 + (a * frac_delay + b) * frac_delay;
+      size_t lfo_pos = (f->lfo_pos +
+          (size_t)(c * f->lfo_length * f->channel_phase + .5)) % f->lfo_length;
+      double * x = lsx_delay_line_write(&f->delay_lines[c], n);
+      double last = f->delay_last[c];
+
+      lsx_read_wave_table(SOX_FLOAT, f->lfo, f->lfo_length, &lfo_pos, lfo, n);
+      for (i = 0; i < n; ++i) {
+        double delayed_0, delayed_1;
+        double delayed;
+        double in, out;
+        double delay = lfo[i];
+        double frac_delay = modf(delay, &delay);
+        double const * d = x + i - (size_t)delay; /* d[-k]: k samples ago */
+
+        in = ibuf[i * channels + c];
+        x[i] = in + last * f->feedback_gain;
+
+        delayed_0 = d[0];
+        delayed_1 = d[-1];
+
+        if (f->interpolation == INTERP_LINEAR)
+          delayed = delayed_0 + (delayed_1 - delayed_0) * frac_delay;
+        else /* if (f->interpolation == INTERP_QUADRATIC) */
+        {
+          double a, b;
+          double delayed_2 = d[-2];
+          delayed_2 -= delayed_0;
+          delayed_1 -= delayed_0;
+          a = delayed_2 *.5 - delayed_1;
+          b = delayed_1 * 2 - delayed_2 *.5;
+          delayed = delayed_0 + (a * frac_delay + b) * frac_delay;
+        }
+
+        last = delayed;
+        out = in * f->in_gain + delayed * f->delay_gain;
+        obuf[i * channels + c] = SOX_ROUND_CLIP_COUNT(out, effp->clips);
       }
-
-      f->delay_last[c] = delayed;
-      out = in * f->in_gain + delayed * f->delay_gain;
-      *obuf++ = SOX_ROUND_CLIP_COUNT(out, effp->clips);
+      f->delay_last[c] = last;
     }
-    f->lfo_pos = (f->lfo_pos + 1) % f->lfo_length;
+    f->lfo_pos = (f->lfo_pos + n) % f->lfo_length;
   }
 
   return SOX_SUCCESS;
@@ -223,7 +227,7 @@ static int stop(sox_effect_t * effp)
   int c, channels = effp->in_signal.channels;
 
   for (c = 0; c < channels; ++c)
-    free(f->delay_bufs[c]);
+    lsx_delay_line_delete(&f->delay_lines[c]);
 
   free(f->lfo);
 
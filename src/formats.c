@@ -1011,8 +1011,12 @@ int sox_seek(sox_format_t * ft, uint64_t offset, int whence)
     /* If file is a seekable file and this handler supports seeking,
      * then invoke handler's function.
      */
-    if (ft->seekable && ft->handler.seek)
-      return (*ft->handler.seek)(ft, offset);
+    if (ft->seekable && ft->handler.seek) {
+      int result = (*ft->handler.seek)(ft, offset);
+      if (result == SOX_SUCCESS && ft->mode == 'r')
+        ft->olength = offset; /* So sox_read stops at the right place */
+      return result;
+    }
     return SOX_EOF; /* FIXME: return SOX_EBADF */
 }
 
@@ -70,23 +70,14 @@ static const char LogTable256[] =
         7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7
 };
 
+/* All callers pass 0 <= val < 0x10000, so only 16 bits need examining */
 static inline int log2plus1(int val)
 {
         /* From http://graphics.stanford.edu/~seander/bithacks.html#IntegerLogLookup */
-        unsigned int v = (unsigned int)val; /* 32-bit word to find the log of */
-        unsigned r;     /* r will be lg(v) */
-        register unsigned int t, tt; /* temporaries */
+        unsigned int v = (unsigned int)val; /* 16-bit word to find the log of */
+        unsigned int t = v >> 8;
 
-        if ((tt = v >> 16))
-        {
-            r = (t = tt >> 8) ? 24 + LogTable256[t] : 16 + LogTable256[tt];
-        }
-        else
-        {
-            r = (t = v >> 8) ? 8 + LogTable256[t] : LogTable256[v];
-        }
-
-        return r + 1;
+        return (t ? 8 + LogTable256[t] : LogTable256[v]) + 1;
 }
 
 /*
@@ -168,13 +159,13 @@ void g72x_init_state(struct g72x_state *state_ptr)
  */
 int predictor_zero(struct g72x_state *state_ptr)
 {
-        int             i;
-        int             sezi;
-
-        sezi = fmult(state_ptr->b[0] >> 2, state_ptr->dq[0]);
-        for (i = 1; i < 6; i++)                 /* ACCUM */
-                sezi += fmult(state_ptr->b[i] >> 2, state_ptr->dq[i]);
-        return (sezi);
+        /* ACCUM; unrolled, as the six products are independent */
+        return fmult(state_ptr->b[0] >> 2, state_ptr->dq[0]) +
+               fmult(state_ptr->b[1] >> 2, state_ptr->dq[1]) +
+               fmult(state_ptr->b[2] >> 2, state_ptr->dq[2]) +
+               fmult(state_ptr->b[3] >> 2, state_ptr->dq[3]) +
+               fmult(state_ptr->b[4] >> 2, state_ptr->dq[4]) +
+               fmult(state_ptr->b[5] >> 2, state_ptr->dq[5]);
 }
 /*
  * predictor_pole()
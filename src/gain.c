@@ -28,7 +28,10 @@ typedef struct {
   double        mult, reclaim, rms, limiter;
   off_t         num_samples;
   sox_sample_t  min, max;
-  FILE          * tmp_file;
+  lsx_tmpsamples_t tmp;
+  uint64_t      tmp_pos;
+  sox_format_t  * source;  /* If not NULL, re-read in drain instead of tmp */
+  sox_bool      draining;
 } priv_t;
 
 static int create(sox_effect_t * effp, int argc, char * * argv)
@@ -81,13 +84,10 @@ static int start(sox_effect_t * effp)
       effp->flows = 1;
   }
   p->mult = p->max = p->min = 0;
-  if (p->do_scan) {
-    p->tmp_file = lsx_tmpfile();
-    if (p->tmp_file == NULL) {
-      lsx_fail("can't create temporary file: %s", strerror(errno));
-      return SOX_EOF;
-    }
-  }
+  lsx_tmpsamples_init(&p->tmp, effp->in_signal.precision);
+  p->tmp_pos = 0;
+  p->source = NULL;
+  p->draining = sox_false;
   if (p->do_limiter)
     p->limiter = (1 - 1 / p->fixed_gain) * (1. / SOX_SAMPLE_MAX);
   else if (p->fixed_gain == floor(p->fixed_gain) && !p->do_scan)
@@ -102,7 +102,7 @@ static int flow(sox_effect_t * effp, const sox_sample_t * ibuf,
   size_t len;
 
   if (p->do_scan) {
-    if (fwrite(ibuf, sizeof(*ibuf), *isamp, p->tmp_file) != *isamp) {
+    if (!p->source && lsx_tmpsamples_write(&p->tmp, ibuf, *isamp) != SOX_SUCCESS) {
       lsx_fail("error writing temporary file: %s", strerror(errno));
       return SOX_EOF;
     }
@@ -150,7 +150,6 @@ static void start_drain(sox_effect_t * effp)
     for (i = 0; i < effp->flows; ++i) {
       priv_t * q = (priv_t *)(effp - effp->flow + i)->priv;
       max_rms = max(max_rms, sqrt(q->rms / q->num_samples));
-      rewind(q->tmp_file);
     }
     for (i = 0; i < effp->flows; ++i) {
       priv_t * q = (priv_t *)(effp - effp->flow + i)->priv;
@@ -171,7 +170,6 @@ static void start_drain(sox_effect_t * effp)
       double this_peak = max(q->max / max, q->min / (double)SOX_SAMPLE_MIN);
       max_peak = max(max_peak, this_peak);
       q->mult = p->fixed_gain / this_peak;
-      rewind(q->tmp_file);
     }
     for (i = 0; i < effp->flows; ++i) {
       priv_t * q = (priv_t *)(effp - effp->flow + i)->priv;
@@ -185,7 +183,6 @@ static void start_drain(sox_effect_t * effp)
       else p->mult = p->reclaim;
     }
     p->mult *= p->fixed_gain;
-    rewind(p->tmp_file);
   }
 }
 
@@ -196,12 +193,25 @@ static int drain(sox_effect_t * effp, sox_sample_t * obuf, size_t * osamp)
   int result = SOX_SUCCESS;
 
   if (p->do_scan) {
-    if (!p->mult)
+    if (!p->draining) {
+      p->draining = sox_true;
       start_drain(effp);
-    len = fread(obuf, sizeof(*obuf), *osamp, p->tmp_file);
-    if (len != *osamp && !feof(p->tmp_file)) {
-      lsx_fail("error reading temporary file: %s", strerror(errno));
-      result = SOX_EOF;
+      if (p->source && sox_seek(p->source, (uint64_t)0, SOX_SEEK_SET) != SOX_SUCCESS) {
+        lsx_fail("can't rewind input file: %s", p->source->sox_errstr);
+        return SOX_EOF;
+      }
+    }
+    if (effp->flows == 1)  /* Whole wide samples only */
+      *osamp -= *osamp % effp->in_signal.channels;
+    if (p->source)   /* Second pass: decode the input again */
+      len = sox_read(p->source, obuf, *osamp);
+    else {
+      len = lsx_tmpsamples_read(&p->tmp, p->tmp_pos, obuf, *osamp);
+      if (len != *osamp && p->tmp_pos + len != lsx_tmpsamples_length(&p->tmp)) {
+        lsx_fail("error reading temporary file: %s", strerror(errno));
+        result = SOX_EOF;
+      }
+      p->tmp_pos += len;
     }
     if (!p->do_limiter) for (*osamp = len; len; --len, ++obuf)
       *obuf = SOX_ROUND_CLIP_COUNT(*obuf * p->mult, effp->clips);
@@ -218,8 +228,18 @@ static int drain(sox_effect_t * effp, sox_sample_t * obuf, size_t * osamp)
 static int stop(sox_effect_t * effp)
 {
   priv_t * p = (priv_t *)effp->priv;
-  if (p->do_scan)
-    fclose(p->tmp_file); /* auto-deleted by lsx_tmpfile */
+  lsx_tmpsamples_close(&p->tmp);
+  return SOX_SUCCESS;
+}
+
+int sox_gain_set_input(sox_effect_t * effp, sox_format_t * ft)
+{
+  priv_t * p = (priv_t *)effp->priv;
+
+  if (!p->do_scan || effp->flows != 1 || p->tmp.tmp.length ||
+      ft->signal.channels != effp->in_signal.channels || !lsx_is_seek_exact(ft))
+    return SOX_EOF;
+  p->source = ft;
   return SOX_SUCCESS;
 }
 
@@ -49,15 +49,24 @@ static const int imaStepSizeTable[ISSTMAX + 1] = {
 
 static unsigned char imaStateAdjustTable[ISSTMAX+1][8];
 
+/* imaDiffTable[state][c] is the magnitude of the step taken for code c,
+ * i.e. what the shift-and-add sequence in the spec evaluates to */
+static int imaDiffTable[ISSTMAX+1][8];
+
 void lsx_ima_init_table(void)
 {
         int i,j,k;
         for (i=0; i<=ISSTMAX; i++) {
                 for (j=0; j<8; j++) {
+                        int step = imaStepSizeTable[i], dp = step >> 3;
                         k = i + imaStateAdjust(j);
                         if (k<0) k=0;
                         else if (k>ISSTMAX) k=ISSTMAX;
                         imaStateAdjustTable[i][j] = k;
+                        if (j & 4) dp += step;
+                        if (j & 2) dp += step >> 1;
+                        if (j & 1) dp += step >> 2;
+                        imaDiffTable[i][j] = dp;
                 }
         }
 }
@@ -92,7 +101,7 @@ static void ImaExpandS(
         op += o_inc;
 
         for (i = 1; i < n; i++) {
-                int step,dp,c,cm;
+                int dp,c,cm;
 
                 if (i&1) {         /* 1st of pair */
                         cm = *ip & 0x0f;
@@ -102,20 +111,11 @@ static void ImaExpandS(
                                 ip += i_inc;   /* skip ip for next group */
                 }
 
-                step = imaStepSizeTable[state];
-                /* Update the state for the next sample */
                 c = cm & 0x07;
+                dp = imaDiffTable[state][c];
+                /* Update the state for the next sample */
                 state = imaStateAdjustTable[state][c];
 
-                dp = 0;
-                if (c & 4) dp += step;
-                step = step >> 1;
-                if (c & 2) dp += step;
-                step = step >> 1;
-                if (c & 1) dp += step;
-                step = step >> 1;
-                dp += step;
-
                 if (c != cm) {
                         val -= dp;
                         if (val<-0x8000) val = -0x8000;
@@ -197,6 +197,7 @@ static int ImaMashS(
                 step = imaStepSizeTable[state];
                 c = (abs(d)<<2)/step;
                 if (c > 7) c = 7;
+                dp = imaDiffTable[state][c];
                 /* Update the state for the next sample */
                 state = imaStateAdjustTable[state][c];
 
@@ -213,15 +214,6 @@ static int ImaMashS(
                         i = (i+1) & 0x07;
                 }
 
-                dp = 0;
-                if (c & 4) dp += step;
-                step = step >> 1;
-                if (c & 2) dp += step;
-                step = step >> 1;
-                if (c & 1) dp += step;
-                step = step >> 1;
-                dp += step;
-
                 if (d<0) {
                         val -= dp;
                         if (val<-0x8000) val = -0x8000;
@@ -241,8 +233,59 @@ static int ImaMashS(
         return (int) sqrt(d2);
 }
 
+/* ImaMashErrs() is ImaMashS() without output, run for k different initial
+ * states at once.  The k trials are independent, so advancing them together
+ * one sample at a time lets their (long, serial) dependency chains overlap */
+#define IMA_MAX_TRIALS (ISSTMAX + 1)
+
+static void ImaMashErrs(
+        unsigned ch,             /* channel number to encode, REQUIRE 0 <= ch < chans  */
+        unsigned chans,          /* total channels */
+        int v0,           /* value to use as starting prediction0 */
+        const SAMPL *ibuff, /* ibuff[] is interleaved input samples */
+        int n,              /* samples to encode PER channel, REQUIRE n % 8 == 1 */
+        const int *st,      /* initial states to try, REQUIRE 0 <= st[j] <= ISSTMAX */
+        int k,              /* number of states to try, 1 <= k <= IMA_MAX_TRIALS */
+        int *err            /* output: rms error for each state, as ImaMashS() */
+)
+{
+        const SAMPL *ip = ibuff + ch, *itop = ibuff + n*chans;
+        int val[IMA_MAX_TRIALS], state[IMA_MAX_TRIALS];
+        double d2[IMA_MAX_TRIALS];
+        int j;
+
+        for (j = 0; j < k; j++) {
+                val[j] = v0;
+                state[j] = st[j];
+                d2[j] = (*ip - v0) * (*ip - v0);
+        }
+        for (ip += chans; ip < itop; ip += chans) {
+                int x = *ip;
+                for (j = 0; j < k; j++) {
+                        int d = x - val[j], c, v;
+
+                        c = (abs(d)<<2)/imaStepSizeTable[state[j]];
+                        if (c > 7) c = 7;
+                        v = imaDiffTable[state[j]][c];
+                        state[j] = imaStateAdjustTable[state[j]][c];
+
+                        if (d<0) {
+                                v = val[j] - v;
+                                if (v<-0x8000) v = -0x8000;
+                        } else {
+                                v = val[j] + v;
+                                if (v>0x7fff) v = 0x7fff;
+                        }
+                        val[j] = v;
+                        d2[j] += (x - v) * (x - v);
+                }
+        }
+        for (j = 0; j < k; j++)
+                err[j] = (int) sqrt(d2[j] / n);
+}
+
 /* mash one channel... if you want to use opt>0, 9 is a reasonable value */
-inline static void ImaMashChannel(
+static void ImaMashChannel(
         unsigned ch,             /* channel number to encode, REQUIRE 0 <= ch < chans  */
         unsigned chans,          /* total channels */
         const SAMPL *ip,    /* ip[] is interleaved input samples */
@@ -252,38 +295,50 @@ inline static void ImaMashChannel(
         int opt             /* non-zero allows some cpu-intensive code to improve output */
 )
 {
-        int snext,d;
         int s0,d0;
-        int s32,d32;
 
-        s32 = s0 = *st;
+        s0 = *st;
         if (opt>0) {
                 int low,hi,w;
                 int low0,hi0;
-                snext = s0;
-                d32 = d0 = ImaMashS(ch, chans, ip[0], ip,n,&snext, NULL);
+                int err[ISSTMAX+1], tried[ISSTMAX+1] = {0};
+                int try[ISSTMAX+1] = {0}, j;
+
+                /* Every state in the initial window is always tried, so try
+                 * them all in one go; the search below then only has to
+                 * compute trials once it has moved beyond that window. */
+                low0 = s0-opt; if (low0<0) low0=0;
+                hi0 = s0+opt; if (hi0>ISSTMAX) hi0=ISSTMAX;
+                for (j = low0; j <= hi0; j++)
+                        try[j - low0] = j;
+                ImaMashErrs(ch, chans, ip[0], ip, n, try, hi0 - low0 + 1, err + low0);
+                for (j = low0; j <= hi0; j++)
+                        tried[j] = 1;
+                d0 = err[s0];
 
                 w = 0;
                 low=hi=s0;
-                low0 = low-opt; if (low0<0) low0=0;
-                hi0 = hi+opt; if (hi0>ISSTMAX) hi0=ISSTMAX;
                 while (low>low0 || hi<hi0) {
                         if (!w && low>low0) {
-                                int d;
-                                snext = --low;
-                                d = ImaMashS(ch, chans, ip[0], ip,n,&snext, NULL);
-                                if (d<d0) {
-                                        d0=d; s0=low;
+                                --low;
+                                if (!tried[low]) {
+                                        ImaMashErrs(ch, chans, ip[0], ip, n, &low, 1, err + low);
+                                        tried[low] = 1;
+                                }
+                                if (err[low]<d0) {
+                                        d0=err[low]; s0=low;
                                         low0 = low-opt; if (low0<0) low0=0;
                                         hi0 = low+opt; if (hi0>ISSTMAX) hi0=ISSTMAX;
                                 }
                         }
                         if (w && hi<hi0) {
-                                int d;
-                                snext = ++hi;
-                                d = ImaMashS(ch, chans, ip[0], ip,n,&snext, NULL);
-                                if (d<d0) {
-                                        d0=d; s0=hi;
+                                ++hi;
+                                if (!tried[hi]) {
+                                        ImaMashErrs(ch, chans, ip[0], ip, n, &hi, 1, err + hi);
+                                        tried[hi] = 1;
+                                }
+                                if (err[hi]<d0) {
+                                        d0=err[hi]; s0=hi;
                                         low0 = hi-opt; if (low0<0) low0=0;
                                         hi0 = hi+opt; if (hi0>ISSTMAX) hi0=ISSTMAX;
                                 }
@@ -292,7 +347,7 @@ inline static void ImaMashChannel(
                 }
                 *st = s0;
         }
-        d = ImaMashS(ch, chans, ip[0], ip,n,st, obuff);
+        ImaMashS(ch, chans, ip[0], ip,n,st, obuff);
 }
 
 /* mash one block.  if you want to use opt>0, 9 is a reasonable value */
@@ -305,9 +360,13 @@ void lsx_ima_block_mash_i(
         int opt             /* non-zero allows some cpu-intensive code to improve output */
 )
 {
-        unsigned ch;
-        for (ch=0; ch<chans; ch++)
-                ImaMashChannel(ch, chans, ip, n, st+ch, obuff, opt);
+        int ch;
+        /* Channels write disjoint bytes of obuff, so can be done in parallel */
+#ifdef HAVE_OPENMP
+        #pragma omp parallel for if (chans > 1 && opt > 0)
+#endif
+        for (ch=0; ch<(int)chans; ch++)
+                ImaMashChannel((unsigned)ch, chans, ip, n, st+ch, obuff, opt);
 }
 
 /*
@@ -53,7 +53,8 @@ sox_globals_t sox_globals = {
   NULL,            /* char const * stdout_in_use_by */
   NULL,            /* char const * subsystem */
   NULL,            /* char       * tmp_path */
-  sox_false        /* sox_bool     use_magic */
+  sox_false,       /* sox_bool     use_magic */
+  64 << 20         /* size_t       tmp_mem_max */
 };
 
 char const * sox_strerror(int sox_errno)
@@ -29,6 +29,10 @@
   #include <unistd.h>
 #endif
 
+#ifdef HAVE_SYS_MMAN_H
+  #include <sys/mman.h>
+#endif
+
 #if defined(_MSC_VER) || defined(__MINGW32__)
   #define MKTEMP_X _O_BINARY|_O_TEMPORARY
 #else
@@ -69,3 +73,85 @@ FILE * lsx_tmpfile(void)
   lsx_debug("tmpfile()");
   return tmpfile();
 }
+
+static int tmpbuf_spill(lsx_tmpbuf_t * t)
+{
+  if (!(t->file = lsx_tmpfile()))
+    return SOX_EOF;
+  lsx_debug("tmpbuf: moving %lu bytes to file", (unsigned long)t->length);
+  if (fwrite(t->mem, (size_t) 1, (size_t)t->length, t->file) != t->length)
+    return SOX_EOF;
+  free(t->mem);
+  t->mem = NULL;
+  t->mem_size = 0;
+  return SOX_SUCCESS;
+}
+
+int lsx_tmpbuf_write(lsx_tmpbuf_t * t, void const * data, size_t len)
+{
+  if (!t->file && t->length + len > t->mem_size) {
+    size_t size = max(t->mem_size * 2, (size_t)t->length + len);
+    char * mem = NULL;
+
+    size = min(max(size, 8192), sox_globals.tmp_mem_max);
+    if (t->length + len > size || !(mem = realloc(t->mem, size))) {
+      if (tmpbuf_spill(t) != SOX_SUCCESS)
+        return SOX_EOF;
+    }
+    else t->mem = mem, t->mem_size = size;
+  }
+  if (!t->file)
+    memcpy(t->mem + t->length, data, len);
+  else {
+    if ((uint64_t)ftello(t->file) != t->length)
+      fseeko(t->file, (off_t)t->length, SEEK_SET);
+    if (fwrite(data, (size_t) 1, len, t->file) != len)
+      return SOX_EOF;
+  }
+  t->length += len;
+  return SOX_SUCCESS;
+}
+
+size_t lsx_tmpbuf_read(lsx_tmpbuf_t * t, uint64_t offset, void * data, size_t len)
+{
+  if (offset >= t->length)
+    return 0;
+  len = (size_t)min(len, t->length - offset);
+  if (!t->file) {
+    memcpy(data, t->mem + offset, len);
+    return len;
+  }
+#ifdef HAVE_SYS_MMAN_H
+  if (offset + len > t->map_size && t->length == (size_t)t->length) {
+    if (t->map)
+      munmap(t->map, t->map_size);
+    fflush(t->file);
+    t->map = mmap(NULL, (size_t)t->length, PROT_READ, MAP_SHARED, fileno(t->file), (off_t)0);
+    t->map_size = (size_t)t->length;
+    if (t->map == MAP_FAILED) {
+      lsx_debug("tmpbuf: can't map file: %s", strerror(errno));
+      t->map = NULL;
+      t->map_size = 0;
+    }
+  }
+  if (offset + len <= t->map_size) {
+    memcpy(data, t->map + offset, len);
+    return len;
+  }
+#endif
+  if (fseeko(t->file, (off_t)offset, SEEK_SET))
+    return 0;
+  return fread(data, (size_t) 1, len, t->file);
+}
+
+void lsx_tmpbuf_close(lsx_tmpbuf_t * t)
+{
+  free(t->mem);
+#ifdef HAVE_SYS_MMAN_H
+  if (t->map)
+    munmap(t->map, t->map_size);
+#endif
+  if (t->file)
+    fclose(t->file); /* auto-deleted by lsx_tmpfile */
+  memset(t, 0, sizeof(*t));
+}
@@ -62,15 +62,18 @@ typedef struct {
   crossover_t filter;
   sox_sample_t *delay_buf;   /* Old samples, used for delay processing */
   size_t delay_size;    /* lookahead for this band (in samples) - function of delay, above */
-  ptrdiff_t delay_buf_ptr; /* Index into delay_buf */
+  size_t delay_buf_ptr; /* Index into delay_buf */
   size_t delay_buf_cnt; /* No. of active entries in delay_buf */
+  sox_sample_t *ibuf, *obuf; /* This band's input (from the crossover) & output */
+  size_t obuf_len;
+  size_t clips;         /* Kept per band, as bands are processed in parallel */
 } comp_band_t;
 
 typedef struct {
   size_t nBands;
-  sox_sample_t *band_buf1, *band_buf2, *band_buf3;
   size_t band_buf_len;
-  size_t delay_buf_size;/* Size of delay_buf in samples */
+  size_t delay_buf_size;/* Total delay, in samples */
+  size_t delay_buf_mask;/* delay_buf is a ring of a power of 2 >= that */
   comp_band_t *bands;
 } priv_t;
 
@@ -168,7 +171,6 @@ static int getopts(sox_effect_t * effp, int argc, char **argv)
   priv_t * c = (priv_t *) effp->priv;
   --argc, ++argv;
 
-  c->band_buf1 = c->band_buf2 = c->band_buf3 = 0;
   c->band_buf_len = 0;
 
   /* how many bands? */
@@ -213,7 +215,7 @@ static int start(sox_effect_t * effp)
 {
   priv_t * c = (priv_t *) effp->priv;
   comp_band_t * l;
-  size_t i;
+  size_t i, ring_size = 1;
   size_t band;
 
   for (band=0;band<c->nBands;++band) {
@@ -222,6 +224,10 @@ static int start(sox_effect_t * effp)
     if (l->delay_size > c->delay_buf_size)
       c->delay_buf_size = l->delay_size;
   }
+  while (ring_size < c->delay_buf_size)
+    ring_size <<= 1;
+  c->delay_buf_mask = ring_size - 1;
+  c->band_buf_len = 0;
 
   for (band=0;band<c->nBands;++band) {
     l = &c->bands[band];
@@ -242,9 +248,11 @@ static int start(sox_effect_t * effp)
 
     /* Allocate the delay buffer */
     if (c->delay_buf_size > 0)
-      l->delay_buf = lsx_calloc(sizeof(long), c->delay_buf_size);
+      l->delay_buf = lsx_calloc(ring_size, sizeof(*l->delay_buf));
     l->delay_buf_ptr = 0;
     l->delay_buf_cnt = 0;
+    l->ibuf = l->obuf = NULL;
+    l->clips = 0;
 
     if (l->topfreq != 0)
       crossover_setup(effp, &l->filter, l->topfreq);
@@ -262,44 +270,49 @@ static void doVolume(double *v, double samp, comp_band_t * l, size_t chan)
   double s = samp/(~((sox_sample_t)1<<31));
   double delta = s - *v;
 
-  if (delta > 0.0) /* increase volume according to attack rate */
-    *v += delta * l->attackRate[chan];
-  else             /* reduce volume according to decay rate */
-    *v += delta * l->decayRate[chan];
+  /* Select (rather than branch on) the attack or decay rate: */
+  *v += delta * (delta > 0.0 ? l->attackRate[chan] : l->decayRate[chan]);
 }
 
-static int sox_mcompand_flow_1(sox_effect_t * effp, priv_t * c, comp_band_t * l, const sox_sample_t *ibuf, sox_sample_t *obuf, size_t len, size_t filechans)
+/*
+ * Compand one band's input (l->ibuf) to its output (l->obuf).
+ * Return the number of samples output.
+ */
+static size_t sox_mcompand_flow_1(priv_t * c, comp_band_t * l, size_t len, size_t filechans)
 {
-  size_t done, chan;
+  sox_sample_t const * ibuf = l->ibuf;
+  sox_sample_t * obuf = l->obuf, * delay_buf = l->delay_buf;
+  size_t i, done = 0, chan, mask = c->delay_buf_mask;
+  /* Samples back from delay_buf_ptr to the one to apply the volume to: */
+  size_t lag = l->delay_size? l->delay_size : c->delay_buf_size;
 
-  for (done = 0; done < len; ibuf += filechans) {
+  for (i = 0; i < len; i += filechans, ibuf += filechans) {
+    double level_out_lin = 0;
 
     /* Maintain the volume fields by simulating a leaky pump circuit */
 
-    if (l->expectedChannels == 1 && filechans > 1) {
+    if (l->expectedChannels == 1) {
       /* User is expecting same compander for all channels */
       double maxsamp = 0.0;
-      for (chan = 0; chan < filechans; ++chan) {
-        double rect = fabs((double)ibuf[chan]);
-        if (rect > maxsamp)
-          maxsamp = rect;
-      }
+      for (chan = 0; chan < filechans; ++chan)
+        maxsamp = max(maxsamp, fabs((double)ibuf[chan]));
       doVolume(&l->volume[0], maxsamp, l, (size_t) 0);
+      level_out_lin = lsx_compandt(&l->transfer_fn, l->volume[0]);
     } else {
-      for (chan = 0; chan < filechans; ++chan)
+      for (chan = 0; chan < filechans; ++chan) /* No dependence: vectorises */
         doVolume(&l->volume[chan], fabs((double)ibuf[chan]), l, chan);
     }
 
     /* Volume memory is updated: perform compand */
     for (chan = 0; chan < filechans; ++chan) {
-      int ch = l->expectedChannels > 1 ? chan : 0;
-      double level_in_lin = l->volume[ch];
-      double level_out_lin = lsx_compandt(&l->transfer_fn, level_in_lin);
       double checkbuf;
 
+      if (l->expectedChannels > 1)
+        level_out_lin = lsx_compandt(&l->transfer_fn, l->volume[chan]);
+
       if (c->delay_buf_size <= 0) {
         checkbuf = ibuf[chan] * level_out_lin;
-        SOX_SAMPLE_CLIP_COUNT(checkbuf, effp->clips);
+        SOX_SAMPLE_CLIP_COUNT(checkbuf, l->clips);
         obuf[done++] = checkbuf;
 
       } else {
@@ -316,22 +329,23 @@ static int sox_mcompand_flow_1(sox_effect_t * effp, priv_t * c, comp_band_t * l,
            vol to, is a constant equal to the difference between this
            band's delay and the longest delay of all the bands. */
 
-        if (l->delay_buf_cnt >= l->delay_size) {
-          checkbuf = l->delay_buf[(l->delay_buf_ptr + c->delay_buf_size - l->delay_size)%c->delay_buf_size] * level_out_lin;
-          SOX_SAMPLE_CLIP_COUNT(checkbuf, effp->clips);
-          l->delay_buf[(l->delay_buf_ptr + c->delay_buf_size - l->delay_size)%c->delay_buf_size] = checkbuf;
+        if (l->delay_buf_cnt >= lag) {
+          sox_sample_t * s = &delay_buf[(l->delay_buf_ptr - lag) & mask];
+          checkbuf = *s * level_out_lin;
+          SOX_SAMPLE_CLIP_COUNT(checkbuf, l->clips);
+          *s = checkbuf;
         }
         if (l->delay_buf_cnt >= c->delay_buf_size)
-          obuf[done++] = l->delay_buf[l->delay_buf_ptr];
+          obuf[done++] = delay_buf[(l->delay_buf_ptr - c->delay_buf_size) & mask];
         else
           l->delay_buf_cnt++;
-        l->delay_buf[l->delay_buf_ptr++] = ibuf[chan];
-        l->delay_buf_ptr %= c->delay_buf_size;
+        delay_buf[l->delay_buf_ptr] = ibuf[chan];
+        l->delay_buf_ptr = (l->delay_buf_ptr + 1) & mask;
       }
     }
   }
 
-  return (SOX_SUCCESS);
+  return done;
 }
 
 /*
@@ -342,51 +356,56 @@ static int flow(sox_effect_t * effp, const sox_sample_t *ibuf, sox_sample_t *obu
                      size_t *isamp, size_t *osamp) {
   priv_t * c = (priv_t *) effp->priv;
   comp_band_t * l;
-  size_t len = min(*isamp, *osamp);
-  size_t band, i;
-  sox_sample_t *abuf, *bbuf, *cbuf, *oldabuf, *ibuf_copy;
+  size_t chans = effp->out_signal.channels;
+  size_t len = min(*isamp, *osamp) / chans * chans, done = 0;
+  size_t i;
+  int band;
   double out;
 
   if (c->band_buf_len < len) {
-    c->band_buf1 = lsx_realloc(c->band_buf1,len*sizeof(sox_sample_t));
-    c->band_buf2 = lsx_realloc(c->band_buf2,len*sizeof(sox_sample_t));
-    c->band_buf3 = lsx_realloc(c->band_buf3,len*sizeof(sox_sample_t));
+    for (band = 0; band < (int)c->nBands; ++band) {
+      l = &c->bands[band];
+      l->ibuf = lsx_realloc(l->ibuf, len * sizeof(*l->ibuf));
+      l->obuf = lsx_realloc(l->obuf, len * sizeof(*l->obuf));
+    }
     c->band_buf_len = len;
   }
 
-  ibuf_copy = lsx_malloc(*isamp * sizeof(sox_sample_t));
-  memcpy(ibuf_copy, ibuf, *isamp * sizeof(sox_sample_t));
+  /* Split ibuf into bands using the filters; each band's high output is the
+   * next band's input: */
+  for (band = 0; band < (int)c->nBands; ++band) {
+    l = &c->bands[band];
+    if (band + 1 < (int)c->nBands && l->topfreq) {
+      crossover_flow(effp, &l->filter, ibuf, l->ibuf, l[1].ibuf, len);
+      ibuf = l[1].ibuf;
+    }
+    else if (ibuf != l->ibuf)
+      memcpy(l->ibuf, ibuf, len * sizeof(*ibuf));
+  }
 
-  /* split ibuf into bands using filters, pipe each band through sox_mcompand_flow_1, then add back together and write to obuf */
+  /* The bands are now independent, so can be companded concurrently: */
+#ifdef HAVE_OPENMP
+  #pragma omp parallel for if (c->nBands > 1)
+#endif
+  for (band = 0; band < (int)c->nBands; ++band)
+    c->bands[band].obuf_len = sox_mcompand_flow_1(c, &c->bands[band], len, chans);
 
-  memset(obuf,0,len * sizeof *obuf);
-  for (band=0,abuf=ibuf_copy,bbuf=c->band_buf2,cbuf=c->band_buf1;band<c->nBands;++band) {
+  /* Add the bands back together: */
+  memset(obuf, 0, len * sizeof(*obuf));
+  for (band = 0; band < (int)c->nBands; ++band) {
     l = &c->bands[band];
-
-    if (l->topfreq)
-      crossover_flow(effp, &l->filter, abuf, bbuf, cbuf, len);
-    else {
-      bbuf = abuf;
-      abuf = cbuf;
-    }
-    if (abuf == ibuf_copy)
-      abuf = c->band_buf3;
-    (void)sox_mcompand_flow_1(effp, c,l,bbuf,abuf,len, (size_t)effp->out_signal.channels);
-    for (i=0;i<len;++i)
-    {
-      out = obuf[i] + abuf[i];
+    done = l->obuf_len; /* The same for all bands */
+    for (i = 0; i < done; ++i) {
+      out = obuf[i] + l->obuf[i];
       SOX_SAMPLE_CLIP_COUNT(out, effp->clips);
       obuf[i] = out;
     }
-    oldabuf = abuf;
-    abuf = cbuf;
-    cbuf = oldabuf;
+    effp->clips += l->clips;
+    l->clips = 0;
   }
 
-  *isamp = *osamp = len;
-
-  free(ibuf_copy);
-
+  *isamp = len;
+  *osamp = done;
   return SOX_SUCCESS;
 }
 
@@ -399,10 +418,9 @@ static int sox_mcompand_drain_1(sox_effect_t * effp, priv_t * c, comp_band_t * l
    * Drain out delay samples.  Note that this loop does all channels.
    */
   for (done = 0;  done < maxdrain  &&  l->delay_buf_cnt > 0;  done++) {
-    out = obuf[done] + l->delay_buf[l->delay_buf_ptr++];
+    out = obuf[done] + l->delay_buf[(l->delay_buf_ptr - l->delay_buf_cnt) & c->delay_buf_mask];
     SOX_SAMPLE_CLIP_COUNT(out, effp->clips);
     obuf[done] = out;
-    l->delay_buf_ptr %= c->delay_buf_size;
     l->delay_buf_cnt--;
   }
 
@@ -420,6 +438,7 @@ static int drain(sox_effect_t * effp, sox_sample_t *obuf, size_t *osamp)
   priv_t * c = (priv_t *)effp->priv;
   comp_band_t * l;
 
+  *osamp -= *osamp % effp->out_signal.channels;
   memset(obuf,0,*osamp * sizeof *obuf);
   for (band=0;band<c->nBands;++band) {
     l = &c->bands[band];
@@ -445,15 +464,10 @@ static int stop(sox_effect_t * effp)
   comp_band_t * l;
   size_t band;
 
-  free(c->band_buf1);
-  c->band_buf1 = NULL;
-  free(c->band_buf2);
-  c->band_buf2 = NULL;
-  free(c->band_buf3);
-  c->band_buf3 = NULL;
-
   for (band = 0; band < c->nBands; band++) {
     l = &c->bands[band];
+    free(l->ibuf);
+    free(l->obuf);
     free(l->delay_buf);
     if (l->topfreq != 0)
       free(l->filter.previous);
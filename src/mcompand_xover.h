@@ -18,10 +18,8 @@
 #define N 4          /* 4th order Linkwitz-Riley IIRs */
 #define CONVOLVE _ _ _ _
 
-typedef struct {double in, out_low, out_high;} previous_t[N * 2];
-
 typedef struct {
-  previous_t * previous;
+  double     * previous; /* N * 2 taps, each in[], out_low[], out_high[] */
   size_t       pos;
   double       coefs[3 *(N+1)];
 } crossover_t;
@@ -63,44 +61,42 @@ static int crossover_setup(sox_effect_t * effp, crossover_t * p, double frequenc
   square_quadratic("hb", x + 3, p->coefs + 5);
   square_quadratic("a" , x + 6, p->coefs + 10);
 
-  p->previous = lsx_calloc(effp->in_signal.channels, sizeof(*p->previous));
+  p->previous = lsx_calloc(N * 2 * 3 * effp->in_signal.channels, sizeof(*p->previous));
   return SOX_SUCCESS;
 }
 
+/* Channels' states are interleaved within each tap, so that the channel loop
+ * is over contiguous data, with no dependence from one channel to the next. */
 static int crossover_flow(sox_effect_t * effp, crossover_t * p, sox_sample_t
-    *ibuf, sox_sample_t *obuf_low, sox_sample_t *obuf_high, size_t len0)
+    const *ibuf, sox_sample_t *obuf_low, sox_sample_t *obuf_high, size_t len0)
 {
-  double out_low, out_high;
-  size_t c, len = len0 / effp->in_signal.channels;
-  assert(len * effp->in_signal.channels == len0);
+  size_t chans = effp->in_signal.channels, stride = 3 * chans;
+  size_t c, len = len0 / chans;
+  assert(len * chans == len0);
+
+  for (; len--; ibuf += chans, obuf_low += chans, obuf_high += chans) {
+    double * in, * low, * high;
 
-  while (len--) {
     p->pos = p->pos? p->pos - 1 : N - 1;
-    for (c = 0; c < effp->in_signal.channels; ++c) {
-#define _ out_low += p->coefs[j] * p->previous[c][p->pos + j].in \
-        - p->coefs[2*N+2 + j] * p->previous[c][p->pos + j].out_low, ++j;
-      {
-        int j = 1;
-        out_low = p->coefs[0] * *ibuf;
-        CONVOLVE
-        assert(j == N+1);
-        *obuf_low++ = SOX_ROUND_CLIP_COUNT(out_low, effp->clips);
-      }
+    in = p->previous + p->pos * stride, low = in + chans, high = low + chans;
+    for (c = 0; c < chans; ++c) {
+      double x = ibuf[c], out_low = p->coefs[0] * x, out_high = p->coefs[N+1] * x;
+      int j = 1;
+#define _ out_low += p->coefs[j] * in[j * stride + c] \
+        - p->coefs[2*N+2 + j] * low[j * stride + c], \
+      out_high += p->coefs[j+N+1] * in[j * stride + c] \
+        - p->coefs[2*N+2 + j] * high[j * stride + c], ++j;
+      CONVOLVE
 #undef _
-#define _ out_high += p->coefs[j+N+1] * p->previous[c][p->pos + j].in \
-        - p->coefs[2*N+2 + j] * p->previous[c][p->pos + j].out_high, ++j;
-      {
-        int j = 1;
-        out_high = p->coefs[N+1] * *ibuf;
-        CONVOLVE
-        assert(j == N+1);
-        *obuf_high++ = SOX_ROUND_CLIP_COUNT(out_high, effp->clips);
-      }
-      p->previous[c][p->pos + N].in = p->previous[c][p->pos].in = *ibuf++;
-      p->previous[c][p->pos + N].out_low = p->previous[c][p->pos].out_low = out_low;
-      p->previous[c][p->pos + N].out_high = p->previous[c][p->pos].out_high = out_high;
+      assert(j == N+1);
+      in[N * stride + c] = in[c] = x;
+      low[N * stride + c] = low[c] = out_low;
+      high[N * stride + c] = high[c] = out_high;
+    }
+    for (c = 0; c < chans; ++c) {
+      obuf_low[c] = SOX_ROUND_CLIP_COUNT(low[c], effp->clips);
+      obuf_high[c] = SOX_ROUND_CLIP_COUNT(high[c], effp->clips);
     }
   }
   return SOX_SUCCESS;
 }
-
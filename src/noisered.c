@@ -9,6 +9,7 @@
  */
 
 #include "noisered.h"
+#include "fft4g.h"
 
 #include <stdlib.h>
 #include <errno.h>
@@ -20,6 +21,10 @@ typedef struct {
     float *lastwindow;
     float *noisegate;
     float *smoothing;
+    double *gate_power;  /* exp(noisegate + threshold * 8) */
+    double *spectrum;    /* WINDOWSIZE; real DFT of the window */
+    double *power;       /* WINDOWSIZE; power spectrum of the Hann'd window */
+    size_t clips;        /* Counted per channel as channels run in parallel */
 } chandata_t;
 
 /* Holds profile information */
@@ -29,29 +34,11 @@ typedef struct {
 
     chandata_t *chandata;
     size_t bufdata;
-} priv_t;
 
-static void FFT(unsigned NumSamples,
-         int InverseTransform,
-         const float *RealIn, float *ImagIn, float *RealOut, float *ImagOut)
-{
-  unsigned i;
-  double * work = malloc(2 * NumSamples * sizeof(*work));
-  for (i = 0; i < 2 * NumSamples; i += 2) {
-    work[i] = RealIn[i >> 1];
-    work[i + 1] = ImagIn? ImagIn[i >> 1] : 0;
-  }
-  lsx_safe_cdft(2 * (int)NumSamples, InverseTransform? -1 : 1, work);
-  if (InverseTransform) for (i = 0; i < 2 * NumSamples; i += 2) {
-    RealOut[i >> 1] = work[i] / NumSamples;
-    ImagOut[i >> 1] = work[i + 1] / NumSamples;
-  }
-  else for (i = 0; i < 2 * NumSamples; i += 2) {
-    RealOut[i >> 1] = work[i];
-    ImagOut[i >> 1] = work[i + 1];
-  }
-  free(work);
-}
+    double *hann;        /* WINDOWSIZE */
+    int *dft_br;         /* DFT tables, private so that channels can run */
+    double *dft_sc;      /* in parallel (these are only read once made) */
+} priv_t;
 
 /*
  * Get the options. Default file is stdin (if the audio
@@ -96,6 +83,10 @@ static int sox_noisered_start(sox_effect_t * effp)
     for (i = 0; i < channels; i ++) {
         data->chandata[i].noisegate = lsx_calloc(FREQCOUNT, sizeof(float));
         data->chandata[i].smoothing = lsx_calloc(FREQCOUNT, sizeof(float));
+        data->chandata[i].gate_power = lsx_malloc(FREQCOUNT * sizeof(double));
+        data->chandata[i].spectrum = lsx_malloc(WINDOWSIZE * sizeof(double));
+        data->chandata[i].power = lsx_malloc(WINDOWSIZE * sizeof(double));
+        data->chandata[i].window = lsx_calloc(WINDOWSIZE, sizeof(float));
         data->chandata[i].lastwindow = NULL;
     }
     while (1) {
@@ -130,46 +121,61 @@ static int sox_noisered_start(sox_effect_t * effp)
     if (ifp != stdin)
       fclose(ifp);
 
+    /* A bin is gated if log(power) < noisegate + threshold * 8, i.e. if
+     * power < exp(noisegate + threshold * 8); so take the logs just once. */
+    for (i = 0; i < channels; i ++) {
+        chandata_t *chan = &data->chandata[i];
+        size_t j;
+        for (j = 0; j < FREQCOUNT; j ++)
+            chan->gate_power[j] = exp(chan->noisegate[j] + data->threshold * 8.0);
+    }
+
+    data->hann = lsx_malloc(WINDOWSIZE * sizeof(*data->hann));
+    for (i = 0; i < WINDOWSIZE; i ++)
+        data->hann[i] = 1;
+    lsx_apply_hann(data->hann, WINDOWSIZE);
+
+    data->dft_br = lsx_calloc(dft_br_len(WINDOWSIZE), sizeof(*data->dft_br));
+    data->dft_sc = lsx_calloc(dft_sc_len(WINDOWSIZE), sizeof(*data->dft_sc));
+    memset(data->chandata[0].spectrum, 0, WINDOWSIZE * sizeof(double));
+    lsx_rdft(WINDOWSIZE, 1, data->chandata[0].spectrum, data->dft_br, data->dft_sc);
+
     return (SOX_SUCCESS);
 }
 
+static float smoothed(double smoothing, double power, double gate_power)
+{
+    double smooth = (power != 0 && power < gate_power)? 0.0 : 1.0;
+    return smooth * 0.5 + smoothing * 0.5;
+}
+
 /* Mangle a single window. Each output sample (except the first and last
  * half-window) is the result of two distinct calls to this function,
  * due to overlapping windows. */
-static void reduce_noise(chandata_t* chan, float* window, double level)
+static void reduce_noise(priv_t * data, chandata_t* chan, float* window)
 {
-    float *inr, *ini, *outr, *outi, *power;
+    double *spectrum = chan->spectrum, *power = chan->power;
     float *smoothing = chan->smoothing;
     int i;
 
-    inr = lsx_calloc(WINDOWSIZE * 5, sizeof(float));
-    ini = inr + WINDOWSIZE;
-    outr = ini + WINDOWSIZE;
-    outi = outr + WINDOWSIZE;
-    power = outi + WINDOWSIZE;
-
     for (i = 0; i < FREQCOUNT; i ++)
         assert(smoothing[i] >= 0 && smoothing[i] <= 1);
 
-    memcpy(inr, window, WINDOWSIZE*sizeof(float));
-
-    FFT(WINDOWSIZE, 0, inr, NULL, outr, outi);
-
-    memcpy(inr, window, WINDOWSIZE*sizeof(float));
-    lsx_apply_hann_f(inr, WINDOWSIZE);
-    lsx_power_spectrum_f(WINDOWSIZE, inr, power);
-
-    for (i = 0; i < FREQCOUNT; i ++) {
-        float smooth;
-        float plog;
-        plog = log(power[i]);
-        if (power[i] != 0 && plog < chan->noisegate[i] + level*8.0)
-            smooth = 0.0;
-        else
-            smooth = 1.0;
-
-        smoothing[i] = smooth * 0.5 + smoothing[i] * 0.5;
+    for (i = 0; i < WINDOWSIZE; i ++) {
+        spectrum[i] = window[i];
+        power[i] = (float)(window[i] * data->hann[i]);
     }
+    lsx_rdft(WINDOWSIZE, 1, spectrum, data->dft_br, data->dft_sc);
+    lsx_rdft(WINDOWSIZE, 1, power, data->dft_br, data->dft_sc);
+
+    /* Packed real DFT: bin i < HALFWINDOW is at 2i (re) & 2i+1 (im), except
+     * that bin HALFWINDOW (which is real, like bin 0) is at 1. */
+    smoothing[0] = smoothed(smoothing[0], (float)sqr(power[0]), chan->gate_power[0]);
+    smoothing[HALFWINDOW] = smoothed(smoothing[HALFWINDOW],
+        (float)sqr(power[1]), chan->gate_power[HALFWINDOW]);
+    for (i = 1; i < HALFWINDOW; i ++) /* Vectorisable */
+        smoothing[i] = smoothed(smoothing[i],
+            (float)(sqr(power[2 * i]) + sqr(power[2 * i + 1])), chan->gate_power[i]);
 
     /* Audacity says this code will eliminate tinkle bells.
      * I have no idea what that means. */
@@ -183,35 +189,24 @@ static void reduce_noise(chandata_t* chan, float* window, double level)
             smoothing[i] = 0.0;
     }
 
-    outr[0] *= smoothing[0];
-    outi[0] *= smoothing[0];
-    outr[FREQCOUNT-1] *= smoothing[FREQCOUNT-1];
-    outi[FREQCOUNT-1] *= smoothing[FREQCOUNT-1];
-
-    for (i = 1; i < FREQCOUNT-1; i ++) {
-        int j = WINDOWSIZE - i;
-        float smooth = smoothing[i];
-
-        outr[i] *= smooth;
-        outi[i] *= smooth;
-        outr[j] *= smooth;
-        outi[j] *= smooth;
+    spectrum[0] *= smoothing[0];
+    spectrum[1] *= smoothing[HALFWINDOW];
+    for (i = 1; i < HALFWINDOW; i ++) {
+        spectrum[2 * i] *= smoothing[i];
+        spectrum[2 * i + 1] *= smoothing[i];
     }
 
-    FFT(WINDOWSIZE, 1, outr, outi, inr, ini);
-    lsx_apply_hann_f(inr, WINDOWSIZE);
-
-    memcpy(window, inr, WINDOWSIZE*sizeof(float));
+    lsx_rdft(WINDOWSIZE, -1, spectrum, data->dft_br, data->dft_sc);
+    for (i = 0; i < WINDOWSIZE; i ++)
+        window[i] = (float)(spectrum[i] * (2. / WINDOWSIZE)) * data->hann[i];
 
     for (i = 0; i < FREQCOUNT; i ++)
         assert(smoothing[i] >= 0 && smoothing[i] <= 1);
-
-    free(inr);
 }
 
 /* Do window management once we have a complete window, including mangling
- * the current window. */
-static int process_window(sox_effect_t * effp, priv_t * data, unsigned chan_num, unsigned num_chans,
+ * the current window.  The last window's buffer is reused for the next. */
+static int process_window(priv_t * data, unsigned chan_num, unsigned num_chans,
                           sox_sample_t *obuf, unsigned len) {
     int j;
     float* nextwindow;
@@ -220,27 +215,25 @@ static int process_window(sox_effect_t * effp, priv_t * data, unsigned chan_num,
     int first = (chan->lastwindow == NULL);
     SOX_SAMPLE_LOCALS;
 
-    if ((nextwindow = lsx_calloc(WINDOWSIZE, sizeof(float))) == NULL)
-        return SOX_EOF;
-
+    nextwindow = first? lsx_malloc(WINDOWSIZE * sizeof(float)) : chan->lastwindow;
     memcpy(nextwindow, chan->window+WINDOWSIZE/2,
            sizeof(float)*(WINDOWSIZE/2));
 
-    reduce_noise(chan, chan->window, data->threshold);
+    reduce_noise(data, chan, chan->window);
     if (!first) {
         for (j = 0; j < use; j ++) {
             float s = chan->window[j] + chan->lastwindow[WINDOWSIZE/2 + j];
             obuf[chan_num + num_chans * j] =
-                SOX_FLOAT_32BIT_TO_SAMPLE(s, effp->clips);
+                SOX_FLOAT_32BIT_TO_SAMPLE(s, chan->clips);
         }
-        free(chan->lastwindow);
     } else {
         for (j = 0; j < use; j ++) {
             assert(chan->window[j] >= -1 && chan->window[j] <= 1);
             obuf[chan_num + num_chans * j] =
-                SOX_FLOAT_32BIT_TO_SAMPLE(chan->window[j], effp->clips);
+                SOX_FLOAT_32BIT_TO_SAMPLE(chan->window[j], chan->clips);
         }
     }
+    memset(nextwindow + WINDOWSIZE/2, 0, sizeof(float)*(WINDOWSIZE/2));
     chan->lastwindow = chan->window;
     chan->window = nextwindow;
 
@@ -260,7 +253,7 @@ static int sox_noisered_flow(sox_effect_t * effp, const sox_sample_t *ibuf, sox_
     size_t ncopy = min(track_samples, WINDOWSIZE-data->bufdata);
     size_t whole_window = (ncopy + data->bufdata == WINDOWSIZE);
     int oldbuf = data->bufdata;
-    size_t i;
+    int i;
 
     /* FIXME: Make this automatic for all effects */
     assert(effp->in_signal.channels == effp->out_signal.channels);
@@ -271,22 +264,26 @@ static int sox_noisered_flow(sox_effect_t * effp, const sox_sample_t *ibuf, sox_
         data->bufdata += ncopy;
 
     /* Reduce noise on every channel. */
-    for (i = 0; i < tracks; i ++) {
+#ifdef HAVE_OPENMP
+    #pragma omp parallel for if (tracks > 1 && whole_window)
+#endif
+    for (i = 0; i < (int)tracks; i ++) {
         SOX_SAMPLE_LOCALS;
         chandata_t* chan = &(data->chandata[i]);
         size_t j;
 
-        if (chan->window == NULL)
-            chan->window = lsx_calloc(WINDOWSIZE, sizeof(float));
-
         for (j = 0; j < ncopy; j ++)
             chan->window[oldbuf + j] =
-                SOX_SAMPLE_TO_FLOAT_32BIT(ibuf[i + tracks * j], effp->clips);
+                SOX_SAMPLE_TO_FLOAT_32BIT(ibuf[i + tracks * j], chan->clips);
 
         if (!whole_window)
             continue;
         else
-            process_window(effp, data, (unsigned) i, (unsigned) tracks, obuf, (unsigned) (oldbuf + ncopy));
+            process_window(data, (unsigned) i, (unsigned) tracks, obuf, (unsigned) (oldbuf + ncopy));
+    }
+    for (i = 0; i < (int)tracks; i ++) {
+        effp->clips += data->chandata[i].clips;
+        data->chandata[i].clips = 0;
     }
 
     *isamp = tracks*ncopy;
@@ -307,8 +304,10 @@ static int sox_noisered_drain(sox_effect_t * effp, sox_sample_t *obuf, size_t *o
     priv_t * data = (priv_t *)effp->priv;
     unsigned i;
     unsigned tracks = effp->in_signal.channels;
-    for (i = 0; i < tracks; i ++)
-        *osamp = process_window(effp, data, i, tracks, obuf, (unsigned) data->bufdata);
+    for (i = 0; i < tracks; i ++) {
+        *osamp = process_window(data, i, tracks, obuf, (unsigned) data->bufdata);
+        effp->clips += data->chandata[i].clips;
+    }
 
     /* FIXME: This is very picky.  osamp needs to be big enough to get all
      * remaining data or it will be discarded.
@@ -330,9 +329,15 @@ static int sox_noisered_stop(sox_effect_t * effp)
         free(chan->window);
         free(chan->smoothing);
         free(chan->noisegate);
+        free(chan->gate_power);
+        free(chan->spectrum);
+        free(chan->power);
     }
 
     free(data->chandata);
+    free(data->hann);
+    free(data->dft_br);
+    free(data->dft_sc);
 
     return (SOX_SUCCESS);
 }
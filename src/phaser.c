@@ -48,13 +48,12 @@ typedef struct {
   double     in_gain, out_gain, delay_ms, decay, mod_speed;
   lsx_wave_t mod_type;
 
-  int        * mod_buf;
+  int        * mod_buf;   /* Modulated delay, in samples */
   size_t     mod_buf_len;
-  int        mod_pos;
-            
-  double     * delay_buf;
+  size_t     mod_pos;
+
+  lsx_delay_line_t delay_line;
   size_t     delay_buf_len;
-  int        delay_pos;
 } priv_t;
 
 static int getopts(sox_effect_t * effp, int argc, char * * argv)
@@ -94,16 +93,19 @@ static int getopts(sox_effect_t * effp, int argc, char * * argv)
 static int start(sox_effect_t * effp)
 {
   priv_t * p = (priv_t *) effp->priv;
+  size_t i;
 
   p->delay_buf_len = p->delay_ms * .001 * effp->in_signal.rate + .5;
-  p->delay_buf = lsx_calloc(p->delay_buf_len, sizeof(*p->delay_buf));
+  lsx_delay_line_create(&p->delay_line, p->delay_buf_len);
 
   p->mod_buf_len = effp->in_signal.rate / p->mod_speed + .5;
   p->mod_buf = lsx_malloc(p->mod_buf_len * sizeof(*p->mod_buf));
   lsx_generate_wave_table(p->mod_type, SOX_INT, p->mod_buf, p->mod_buf_len,
       1., (double)p->delay_buf_len, M_PI_2);
+  for (i = 0; i < p->mod_buf_len; ++i) /* Offset in the buffer -> delay */
+    p->mod_buf[i] = p->delay_buf_len + 1 - p->mod_buf[i];
 
-  p->delay_pos = p->mod_pos = 0;
+  p->mod_pos = 0;
   return SOX_SUCCESS;
 }
 
@@ -111,17 +113,17 @@ static int flow(sox_effect_t * effp, const sox_sample_t *ibuf,
     sox_sample_t *obuf, size_t *isamp, size_t *osamp)
 {
   priv_t * p = (priv_t *) effp->priv;
-  size_t len = *isamp = *osamp = min(*isamp, *osamp);
-
-  while (len--) {
-    double d = *ibuf++ * p->in_gain + p->delay_buf[
-      (p->delay_pos + p->mod_buf[p->mod_pos]) % p->delay_buf_len] * p->decay;
-    p->mod_pos = (p->mod_pos + 1) % p->mod_buf_len;
-    
-    p->delay_pos = (p->delay_pos + 1) % p->delay_buf_len;
-    p->delay_buf[p->delay_pos] = d;
-
-    *obuf++ = SOX_ROUND_CLIP_COUNT(d * p->out_gain, effp->clips);
+  size_t i, n, len = *isamp = *osamp = min(*isamp, *osamp);
+  int delay[LSX_DELAY_LINE_BLOCK_LEN];
+
+  for (; len; len -= n) {
+    double * x = lsx_delay_line_write(&p->delay_line, n = min(len, array_length(delay)));
+    lsx_read_wave_table(SOX_INT, p->mod_buf, p->mod_buf_len, &p->mod_pos, delay, n);
+    for (i = 0; i < n; ++i) {
+      double d = *ibuf++ * p->in_gain + x[(ptrdiff_t)i - delay[i]] * p->decay;
+      x[i] = d;
+      *obuf++ = SOX_ROUND_CLIP_COUNT(d * p->out_gain, effp->clips);
+    }
   }
   return SOX_SUCCESS;
 }
@@ -130,7 +132,7 @@ static int stop(sox_effect_t * effp)
 {
   priv_t * p = (priv_t *) effp->priv;
 
-  free(p->delay_buf);
+  lsx_delay_line_delete(&p->delay_line);
   free(p->mod_buf);
   return SOX_SUCCESS;
 }
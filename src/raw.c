@@ -81,10 +81,25 @@ int lsx_rawstart(sox_format_t * ft, sox_bool default_rate,
     return nread; \
   }
 
-READ_SAMPLES_FUNC(b, 1, u, uint8_t, uint8_t, SOX_UNSIGNED_8BIT_TO_SAMPLE)
-READ_SAMPLES_FUNC(b, 1, s, int8_t, uint8_t, SOX_SIGNED_8BIT_TO_SAMPLE)
-READ_SAMPLES_FUNC(b, 1, ulaw, uint8_t, uint8_t, SOX_ULAW_BYTE_TO_SAMPLE)
-READ_SAMPLES_FUNC(b, 1, alaw, uint8_t, uint8_t, SOX_ALAW_BYTE_TO_SAMPLE)
+/* Byte-sized samples need no separate buffer: they are read into the top
+ * quarter of buf, then expanded upwards in place; sample n is written only
+ * below the bytes still to be expanded. */
+#define READ_BYTES_FUNC(sign, ctype, cast) \
+  static size_t sox_read_ ## sign ## b_samples( \
+      sox_format_t * ft, sox_sample_t *buf, size_t len) \
+  { \
+    size_t n, nread; \
+    ctype *data = (ctype *)(buf + len) - len; \
+    nread = lsx_read_b_buf(ft, (uint8_t *)data, len); \
+    for (n = 0; n < nread; n++) \
+      buf[n] = cast(data[n], ft->clips); \
+    return nread; \
+  }
+
+READ_BYTES_FUNC(u, uint8_t, SOX_UNSIGNED_8BIT_TO_SAMPLE)
+READ_BYTES_FUNC(s, int8_t, SOX_SIGNED_8BIT_TO_SAMPLE)
+READ_BYTES_FUNC(ulaw, uint8_t, SOX_ULAW_BYTE_TO_SAMPLE)
+READ_BYTES_FUNC(alaw, uint8_t, SOX_ALAW_BYTE_TO_SAMPLE)
 READ_SAMPLES_FUNC(w, 2, u, uint16_t, uint16_t, SOX_UNSIGNED_16BIT_TO_SAMPLE)
 READ_SAMPLES_FUNC(w, 2, s, int16_t, uint16_t, SOX_SIGNED_16BIT_TO_SAMPLE)
 READ_SAMPLES_FUNC(3, 3, u, uint24_t, uint24_t, SOX_UNSIGNED_24BIT_TO_SAMPLE)
@@ -112,8 +127,36 @@ READ_SAMPLES_FUNC(df, sizeof(double), su, double, double, SOX_FLOAT_64BIT_TO_SAM
 
 WRITE_SAMPLES_FUNC(b, 1, u, uint8_t, uint8_t, SOX_SAMPLE_TO_UNSIGNED_8BIT) 
 WRITE_SAMPLES_FUNC(b, 1, s, int8_t, uint8_t, SOX_SAMPLE_TO_SIGNED_8BIT)
-WRITE_SAMPLES_FUNC(b, 1, ulaw, uint8_t, uint8_t, SOX_SAMPLE_TO_ULAW_BYTE) 
-WRITE_SAMPLES_FUNC(b, 1, alaw, uint8_t, uint8_t, SOX_SAMPLE_TO_ALAW_BYTE)
+
+/* G.711 encoding: the clip test selects rather than branches, then there is
+ * one table look-up; bytes go out via a small local buffer, not one
+ * allocated per call. */
+#define WRITE_G711_FUNC(name, bits, table) \
+  static size_t sox_write_ ## name ## b_samples( \
+      sox_format_t * ft, sox_sample_t const * buf, size_t len) \
+  { \
+    uint8_t data[4096]; \
+    size_t done, n, i, nwritten, clips = 0; \
+    for (done = 0; done < len; done += n) { \
+      n = min(len - done, sizeof(data)); \
+      for (i = 0; i < n; ++i) { \
+        uint32_t d = (uint32_t)buf[done + i] + (1 << (31 - bits)); \
+        int clip = buf[done + i] > SOX_SAMPLE_MAX - (1 << (31 - bits)); \
+        clips += clip; \
+        data[i] = table[clip? (1 << bits) - 1 : (d >> (32 - bits)) ^ (1 << (bits - 1))]; \
+      } \
+      nwritten = lsx_write_b_buf(ft, data, n); \
+      if (nwritten != n) { \
+        done += nwritten; \
+        break; \
+      } \
+    } \
+    ft->clips += clips; \
+    return done; \
+  }
+
+WRITE_G711_FUNC(ulaw, 14, lsx_14linear2ulaw)
+WRITE_G711_FUNC(alaw, 13, lsx_13linear2alaw)
 WRITE_SAMPLES_FUNC(w, 2, u, uint16_t, uint16_t, SOX_SAMPLE_TO_UNSIGNED_16BIT) 
 WRITE_SAMPLES_FUNC(w, 2, s, int16_t, uint16_t, SOX_SAMPLE_TO_SIGNED_16BIT)
 WRITE_SAMPLES_FUNC(3, 3, u, uint24_t, uint24_t, SOX_SAMPLE_TO_UNSIGNED_24BIT) 
@@ -194,3 +237,49 @@ size_t lsx_rawwrite(
     return write_buf(ft, buf, nsamp);
   return 0;
 }
+
+static sox_bool is_g711(sox_format_t const * ft)
+{
+  return ft->encoding.bits_per_sample == 8 &&
+    (ft->encoding.encoding == SOX_ENCODING_ULAW ||
+     ft->encoding.encoding == SOX_ENCODING_ALAW);
+}
+
+sox_bool sox_can_transcode(sox_format_t const * ift, sox_format_t const * oft)
+{
+  return ift->handler.read == lsx_rawread && is_g711(ift) &&
+    oft->handler.write == lsx_rawwrite && is_g711(oft) &&
+    ift->signal.channels == oft->signal.channels;
+}
+
+/* The byte map is made through the sample conversions, so the result is just
+ * as through sox_sample_t; G.711 decodes to 16 bits, so nothing clips. */
+size_t sox_transcode(sox_format_t * ift, sox_format_t * oft, size_t len)
+{
+  uint8_t map[256], data[4096];
+  size_t i, n, nread, nwritten, done, clips = 0;
+  unsigned channels = ift->signal.channels;
+  SOX_SAMPLE_LOCALS;
+
+  for (i = 0; i < 256; ++i) {
+    sox_sample_t d = ift->encoding.encoding == SOX_ENCODING_ULAW?
+      SOX_ULAW_BYTE_TO_SAMPLE(i, clips) : SOX_ALAW_BYTE_TO_SAMPLE(i, clips);
+    map[i] = oft->encoding.encoding == SOX_ENCODING_ULAW?
+      SOX_SAMPLE_TO_ULAW_BYTE(d, clips) : SOX_SAMPLE_TO_ALAW_BYTE(d, clips);
+  }
+  if (ift->signal.length != SOX_UNSPEC)
+    len = min(len, ift->signal.length - ift->olength);
+  for (done = 0; done < len; done += nwritten) {
+    n = min(len - done, sizeof(data) / channels * channels);
+    nread = lsx_read_b_buf(ift, data, n);
+    ift->olength += nread;
+    nread -= nread % channels;  /* As sox_read_wide would */
+    for (i = 0; i < nread; ++i)
+      data[i] = map[data[i]];
+    nwritten = lsx_write_b_buf(oft, data, nread);
+    oft->olength += nwritten;
+    if (nwritten != n)
+      return done + nwritten;
+  }
+  return done;
+}
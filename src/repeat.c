@@ -20,8 +20,8 @@
 
 typedef struct {
   unsigned      num_repeats, remaining_repeats;
-  off_t         num_samples, remaining_samples;
-  FILE          * tmp_file;
+  uint64_t      num_samples, remaining_samples;
+  lsx_tmpsamples_t tmp;
 } priv_t;
 
 static int create(sox_effect_t * effp, int argc, char * * argv)
@@ -39,10 +39,7 @@ static int start(sox_effect_t * effp)
   if (!p->num_repeats)
     return SOX_EFF_NULL;
 
-  if (!(p->tmp_file = lsx_tmpfile())) {
-    lsx_fail("can't create temporary file: %s", strerror(errno));
-    return SOX_EOF;
-  }
+  lsx_tmpsamples_init(&p->tmp, effp->in_signal.precision);
   p->num_samples = p->remaining_samples = 0;
   p->remaining_repeats = p->num_repeats + 1;
   return SOX_SUCCESS;
@@ -52,7 +49,7 @@ static int flow(sox_effect_t * effp, const sox_sample_t * ibuf,
     sox_sample_t * obuf, size_t * isamp, size_t * osamp)
 {
   priv_t * p = (priv_t *)effp->priv;
-  if (fwrite(ibuf, sizeof(*ibuf), *isamp, p->tmp_file) != *isamp) {
+  if (lsx_tmpsamples_write(&p->tmp, ibuf, *isamp) != SOX_SUCCESS) {
     lsx_fail("error writing temporary file: %s", strerror(errno));
     return SOX_EOF;
   }
@@ -70,10 +67,10 @@ static int drain(sox_effect_t * effp, sox_sample_t * obuf, size_t * osamp)
     if (!p->remaining_samples) {
       p->remaining_samples = p->num_samples;
       --p->remaining_repeats;
-      rewind(p->tmp_file);
     }
-    n = min(p->remaining_samples, (off_t)(*osamp - odone));
-    if ((fread(obuf + odone, sizeof(*obuf), n, p->tmp_file)) != n) {
+    n = min(p->remaining_samples, *osamp - odone);
+    if (lsx_tmpsamples_read(&p->tmp, p->num_samples - p->remaining_samples,
+          obuf + odone, n) != n) {
       lsx_fail("error reading temporary file: %s", strerror(errno));
       return SOX_EOF;
     }
@@ -87,7 +84,7 @@ static int drain(sox_effect_t * effp, sox_sample_t * obuf, size_t * osamp)
 static int stop(sox_effect_t * effp)
 {
   priv_t * p = (priv_t *)effp->priv;
-  fclose(p->tmp_file); /* auto-deleted by lsx_tmpfile */
+  lsx_tmpsamples_close(&p->tmp);
   return SOX_SUCCESS;
 }
 
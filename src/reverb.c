@@ -21,84 +21,118 @@
 #include "fifo.h"
 
 #define lsx_zalloc(var, n) var = lsx_calloc(n, sizeof(*var))
-#define filter_create(p, n) (p)->ptr=lsx_zalloc((p)->buffer, (p)->size=(size_t)(n))
-#define filter_advance(p) if (--(p)->ptr < (p)->buffer) (p)->ptr += (p)->size
-#define filter_delete(p) free((p)->buffer)
-
-typedef struct {
-  size_t  size;
-  float   * buffer, * ptr;
-  float   store;
-} filter_t;
-
-static float comb_process(filter_t * p,  /* gcc -O2 will inline this */
-    float const * input, float const * feedback, float const * hf_damping)
-{
-  float output = *p->ptr;
-  p->store = output + (p->store - output) * *hf_damping;
-  *p->ptr = *input + p->store * *feedback;
-  filter_advance(p);
-  return output;
-}
-
-static float allpass_process(filter_t * p,  /* gcc -O2 will inline this */
-    float const * input)
-{
-  float output = *p->ptr;
-  *p->ptr = *input + output * .5;
-  filter_advance(p);
-  return output - *input;
-}
 
 static const size_t /* Filter delay lengths in samples (44100Hz sample-rate) */
   comb_lengths[] = {1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617},
   allpass_lengths[] = {225, 341, 441, 556};
 #define stereo_adjust 12
+#define num_combs array_length(comb_lengths)
+#define num_allpasses array_length(allpass_lengths)
 
+#define BLOCK_LEN 128 /* Max. samples processed together */
+
+/* The filters of the 1 or 2 (for stereo-depth) arrays.  All the delay lines
+ * are rings of the same power of 2 length, so share a position; they are
+ * processed a block at a time, such that no ring wraps within a block.  The
+ * samples that a block reads from a delay line were written before it (as
+ * long as it is no longer than the shortest delay), so each allpass can be
+ * run over a whole block before the next. */
 typedef struct {
-  filter_t comb   [array_length(comb_lengths)];
-  filter_t allpass[array_length(allpass_lengths)];
+  size_t  num_arrays, mask, pos, block_len;
+  size_t  comb_delay[2 * num_combs], allpass_delay[num_allpasses][2];
+  float   comb_store[2 * num_combs];
+  float   * comb[2 * num_combs], * allpass[num_allpasses][2];  /* Rings */
 } filter_array_t;
 
 static void filter_array_create(filter_array_t * p, double rate,
-    double scale, double offset)
+    double scale, double depth, size_t num_arrays)
 {
-  size_t i;
+  size_t i, j, max_delay = 0;
   double r = rate * (1 / 44100.); /* Compensate for actual sample-rate */
 
-  for (i = 0; i < array_length(comb_lengths); ++i, offset = -offset)
-    filter_create(&p->comb[i], scale * r * (comb_lengths[i] + stereo_adjust * offset) + .5);
-  for (i = 0; i < array_length(allpass_lengths); ++i, offset = -offset)
-    filter_create(&p->allpass[i], r * (allpass_lengths[i] + stereo_adjust * offset) + .5);
+  p->num_arrays = num_arrays;
+  p->block_len = BLOCK_LEN;
+  for (j = 0; j < num_arrays; ++j) {
+    double offset = j * depth;
+    for (i = 0; i < num_combs; ++i, offset = -offset) {
+      size_t * d = &p->comb_delay[j * num_combs + i];
+      *d = max(1, scale * r * (comb_lengths[i] + stereo_adjust * offset) + .5);
+      max_delay = max(max_delay, *d), p->block_len = min(p->block_len, *d);
+    }
+    for (i = 0; i < num_allpasses; ++i, offset = -offset) {
+      size_t * d = &p->allpass_delay[i][j];
+      *d = max(1, r * (allpass_lengths[i] + stereo_adjust * offset) + .5);
+      max_delay = max(max_delay, *d), p->block_len = min(p->block_len, *d);
+    }
+  }
+  for (p->mask = 1; p->mask < max_delay; p->mask <<= 1);
+  for (i = 0; i < num_arrays * num_combs; ++i)
+    lsx_zalloc(p->comb[i], p->mask);
+  for (i = 0; i < num_allpasses; ++i) for (j = 0; j < num_arrays; ++j)
+    lsx_zalloc(p->allpass[i][j], p->mask);
+  --p->mask;
 }
 
 static void filter_array_process(filter_array_t * p,
-    size_t length, float const * input, float * output,
+    size_t length, float const * input, float * * output,
     float const * feedback, float const * hf_damping, float const * gain)
 {
-  while (length--) {
-    float out = 0, in = *input++;
-
-    size_t i = array_length(comb_lengths) - 1;
-    do out += comb_process(p->comb + i, &in, feedback, hf_damping);
-    while (i--);
-
-    i = array_length(allpass_lengths) - 1;
-    do out = allpass_process(p->allpass + i, &out);
-    while (i--);
-
-    *output++ = out * *gain;
+  size_t i, j, t, done, len, mask = p->mask, n = p->num_arrays;
+  float const * from[2 * num_combs];
+  float store[2 * num_combs], fb = *feedback, damping = *hf_damping;
+
+  memcpy(store, p->comb_store, sizeof(store));
+  for (done = 0; done < length; done += len, p->pos = (p->pos + len) & mask) {
+    len = min(length - done, min(p->block_len, mask + 1 - p->pos));
+    for (i = 0; i < n * num_combs; ++i) {  /* Shorten the block so that */
+      size_t r = (p->pos - p->comb_delay[i]) & mask; /* no ring wraps in it */
+      len = min(len, mask + 1 - r);
+      from[i] = p->comb[i] + r;
+    }
+    for (i = 0; i < num_allpasses; ++i) for (j = 0; j < n; ++j)
+      len = min(len, mask + 1 - ((p->pos - p->allpass_delay[i][j]) & mask));
+
+    for (j = 0; j < n; ++j) {
+      float const * in = input + done, * const * r = from + j * num_combs;
+      float * const * w = p->comb + j * num_combs, * s = store + j * num_combs;
+      float * y = output[j] + done;
+
+      for (t = 0; t < len; ++t) {
+        float out = 0;
+        i = num_combs - 1;
+        do {
+          float o = r[i][t];
+          s[i] = o + (s[i] - o) * damping;
+          w[i][p->pos + t] = in[t] + s[i] * fb;
+          out += o;
+        } while (i--);
+        y[t] = out;
+      }
+      i = num_allpasses - 1;
+      do {
+        float * ring = p->allpass[i][j];
+        float const * o = ring + ((p->pos - p->allpass_delay[i][j]) & mask);
+        for (t = 0; t < len; ++t) {
+          float output = o[t];
+          ring[p->pos + t] = y[t] + output * .5;
+          y[t] = output - y[t];
+        }
+      } while (i--);
+      for (t = 0; t < len; ++t)
+        y[t] *= *gain;
+    }
   }
+  memcpy(p->comb_store, store, sizeof(store));
 }
 
 static void filter_array_delete(filter_array_t * p)
 {
-  size_t i;
+  size_t i, j;
 
-  for (i = 0; i < array_length(allpass_lengths); ++i)
-    filter_delete(&p->allpass[i]);
-  for (i = 0; i < array_length(comb_lengths); ++i)
-    filter_delete(&p->comb[i]);
+  for (i = 0; i < num_allpasses; ++i) for (j = 0; j < p->num_arrays; ++j)
+    free(p->allpass[i][j]);
+  for (i = 0; i < p->num_arrays * num_combs; ++i)
+    free(p->comb[i]);
 }
 
 typedef struct {
@@ -106,7 +140,7 @@ typedef struct {
   float hf_damping;
   float gain;
   fifo_t input_fifo;
-  filter_array_t chan[2];
+  filter_array_t filters;
   float * out[2];
 } reverb_t;
 
@@ -132,27 +166,23 @@ static void reverb_create(reverb_t * p, double sample_rate_Hz,
   p->gain = dB_to_linear(wet_gain_dB) * .015;
   fifo_create(&p->input_fifo, sizeof(float));
   memset(fifo_write(&p->input_fifo, delay, 0), 0, delay * sizeof(float));
-  for (i = 0; i <= ceil(depth); ++i) {
-    filter_array_create(p->chan + i, sample_rate_Hz, scale, i * depth);
+  for (i = 0; i <= ceil(depth); ++i)
     out[i] = lsx_zalloc(p->out[i], buffer_size);
-  }
+  filter_array_create(&p->filters, sample_rate_Hz, scale, depth, i);
 }
 
 static void reverb_process(reverb_t * p, size_t length)
 {
-  size_t i;
-  for (i = 0; i < 2 && p->out[i]; ++i)
-    filter_array_process(p->chan + i, length, (float *) fifo_read_ptr(&p->input_fifo), p->out[i], &p->feedback, &p->hf_damping, &p->gain);
+  filter_array_process(&p->filters, length, (float *) fifo_read_ptr(&p->input_fifo), p->out, &p->feedback, &p->hf_damping, &p->gain);
   fifo_read(&p->input_fifo, length, NULL);
 }
 
 static void reverb_delete(reverb_t * p)
 {
   size_t i;
-  for (i = 0; i < 2 && p->out[i]; ++i) {
+  for (i = 0; i < 2 && p->out[i]; ++i)
     free(p->out[i]);
-    filter_array_delete(p->chan + i);
-  }
+  filter_array_delete(&p->filters);
   fifo_delete(&p->input_fifo);
 }
 
@@ -7,26 +7,30 @@
  */
 
 /*
- * "reverse" effect, uses a temporary file created by lsx_tmpfile().
+ * "reverse" effect, holds its input in an lsx_tmpbuf_t (memory, or a
+ * temporary file), or, if given one by sox_reverse_set_input, reads a
+ * seekable input file backwards.
  */
 
 #include "sox_i.h"
 #include <string.h>
 
+#define BLOCK_LEN 65536 /* Samples read at a time (before reversing) */
+
 typedef struct {
-  off_t         pos;
-  FILE          * tmp_file;
+  lsx_tmpbuf_t  tmp;
+  sox_format_t  * source;   /* If not NULL, read directly from here */
+  uint64_t      pos;        /* Samples (before block) yet to be output */
+  sox_bool      draining;
+  sox_sample_t  * block;
+  size_t        block_len;  /* Samples in block yet to be output */
 } priv_t;
 
 static int start(sox_effect_t * effp)
 {
   priv_t * p = (priv_t *)effp->priv;
-  p->pos = 0;
-  p->tmp_file = lsx_tmpfile();
-  if (p->tmp_file == NULL) {
-    lsx_fail("can't create temporary file: %s", strerror(errno));
-    return SOX_EOF;
-  }
+  memset(p, 0, sizeof(*p));
+  p->block = lsx_malloc(BLOCK_LEN * sizeof(*p->block));
   return SOX_SUCCESS;
 }
 
@@ -34,7 +38,7 @@ static int flow(sox_effect_t * effp, const sox_sample_t * ibuf,
     sox_sample_t * obuf, size_t * isamp, size_t * osamp)
 {
   priv_t * p = (priv_t *)effp->priv;
-  if (fwrite(ibuf, sizeof(*ibuf), *isamp, p->tmp_file) != *isamp) {
+  if (lsx_tmpbuf_write(&p->tmp, ibuf, *isamp * sizeof(*ibuf)) != SOX_SUCCESS) {
     lsx_fail("error writing temporary file: %s", strerror(errno));
     return SOX_EOF;
   }
@@ -45,42 +49,77 @@ static int flow(sox_effect_t * effp, const sox_sample_t * ibuf,
 static int drain(sox_effect_t * effp, sox_sample_t *obuf, size_t *osamp)
 {
   priv_t * p = (priv_t *)effp->priv;
-  int i, j;
+  size_t chans = effp->in_signal.channels, n, i;
+  sox_sample_t const * f;
 
-  if (p->pos == 0) {
-    fflush(p->tmp_file);
-    p->pos = ftello(p->tmp_file);
-    if (p->pos % sizeof(sox_sample_t) != 0) {
+  if (!p->draining) {
+    p->draining = sox_true;
+    p->pos = p->source? p->source->signal.length :
+      p->tmp.length / sizeof(sox_sample_t);
+    if (p->pos % chans != 0) {
       lsx_fail("temporary file has incorrect size");
       return SOX_EOF;
     }
-    p->pos /= sizeof(sox_sample_t);
-  }
-  p->pos -= *osamp = min((off_t)*osamp, p->pos);
-  fseeko(p->tmp_file, (off_t)(p->pos * sizeof(sox_sample_t)), SEEK_SET);
-  if (fread(obuf, sizeof(sox_sample_t), *osamp, p->tmp_file) != *osamp) {
-    lsx_fail("error reading temporary file: %s", strerror(errno));
-    return SOX_EOF;
   }
-  for (i = 0, j = *osamp - 1; i < j; ++i, --j) { /* reverse the samples */
-    sox_sample_t temp = obuf[i];
-    obuf[i] = obuf[j];
-    obuf[j] = temp;
+  if (!p->block_len && p->pos) {   /* Read the next block back */
+    n = min(p->pos, BLOCK_LEN / chans * chans);
+    p->pos -= n;
+    if (p->source) {
+      if (sox_seek(p->source, p->pos, SOX_SEEK_SET) != SOX_SUCCESS ||
+          sox_read(p->source, p->block, n) != n) {
+        lsx_fail("error reading input file: %s", p->source->sox_errstr);
+        return SOX_EOF;
+      }
+    }
+    else if (lsx_tmpbuf_read(&p->tmp, p->pos * sizeof(*p->block), p->block,
+          n * sizeof(*p->block)) != n * sizeof(*p->block)) {
+      lsx_fail("error reading temporary file: %s", strerror(errno));
+      return SOX_EOF;
+    }
+    p->block_len = n;
   }
-  return p->pos? SOX_SUCCESS : SOX_EOF;
+  *osamp = n = min(*osamp / chans * chans, p->block_len);
+  p->block_len -= n;
+  f = p->block + p->block_len + n;
+  if (chans == 1) for (i = 0; i < n; ++i)
+    obuf[i] = *--f;
+  else for (; n; n -= chans, obuf += chans) /* Reverse the wide samples */
+    memcpy(obuf, f -= chans, chans * sizeof(*obuf));
+  return p->pos || p->block_len? SOX_SUCCESS : SOX_EOF;
 }
 
 static int stop(sox_effect_t * effp)
 {
   priv_t * p = (priv_t *)effp->priv;
-  fclose(p->tmp_file); /* auto-deleted by lsx_tmpfile */
+  lsx_tmpbuf_close(&p->tmp);
+  free(p->block);
+  return SOX_SUCCESS;
+}
+
+int sox_reverse_set_input(sox_effect_t * effp, sox_format_t * ft)
+{
+  priv_t * p = (priv_t *)effp->priv;
+  sox_sample_t * s = p->block;
+  size_t chans = ft->signal.channels;
+
+  /* Check that seeking is sample-accurate & that the length is right: */
+  if (!lsx_is_seek_exact(ft) || !ft->signal.length ||
+      ft->signal.length == SOX_IGNORE_LENGTH || chans != effp->in_signal.channels ||
+      ft->signal.length % chans != 0 || p->tmp.length ||
+      sox_seek(ft, ft->signal.length - chans, SOX_SEEK_SET) != SOX_SUCCESS)
+    return SOX_EOF;
+  if (sox_read(ft, s, chans) != chans) {
+    sox_seek(ft, (uint64_t)0, SOX_SEEK_SET);
+    return SOX_EOF;
+  }
+  p->source = ft;
   return SOX_SUCCESS;
 }
 
 sox_effect_handler_t const * lsx_reverse_effect_fn(void)
 {
   static sox_effect_handler_t handler = {
-    "reverse", NULL, SOX_EFF_MODIFY, NULL, start, flow, drain, stop, NULL, sizeof(priv_t)
+    "reverse", NULL, SOX_EFF_MCHAN | SOX_EFF_MODIFY, NULL, start, flow, drain, stop, NULL, sizeof(priv_t)
   };
   return &handler;
 }
@@ -56,6 +56,8 @@ typedef struct {
     double      *window_end;
     size_t   window_size;
     double      rms_sum;
+    double      start_sum_threshold; /* The thresholds, as window sums */
+    double      stop_sum_threshold;
 
     char        leave_silence;
 
@@ -219,6 +221,53 @@ static int sox_silence_getopts(sox_effect_t * effp, int argc, char **argv)
     return(SOX_SUCCESS);
 }
 
+static sox_bool aboveThreshold(sox_effect_t const * effp,
+    sox_sample_t value /* >= 0 */, double threshold, int unit)
+{
+  /* When scaling low bit data, noise values got scaled way up */
+  /* Only consider the original bits when looking for silence */
+  sox_sample_t masked_value = value & (-1 << (32 - effp->in_signal.precision));
+
+  double scaled_value = (double)masked_value / SOX_SAMPLE_MAX;
+
+  if (unit == '%')
+    scaled_value *= 100;
+  else if (unit == 'd')
+    scaled_value = linear_to_dB(scaled_value);
+
+  return scaled_value > threshold;
+}
+
+/* Whether the RMS level given by a window sum of squares is above threshold: */
+static sox_bool sumAboveThreshold(sox_effect_t const * effp,
+    double sum, double threshold, int unit)
+{
+    priv_t * silence = (priv_t *) effp->priv;
+    double rms = sqrt(sum / silence->window_size);
+
+    return aboveThreshold(effp, (sox_sample_t)min(rms, SOX_SAMPLE_MAX),
+                          threshold, unit);
+}
+
+/* The above test depends only on (and rises with) the window sum, so can be
+ * replaced by a comparison with the smallest sum that passes it; found here
+ * by bisection.  The per-sample sqrt & log10 are thus avoided. */
+static double sumThreshold(sox_effect_t const * effp, double threshold, int unit)
+{
+    priv_t * silence = (priv_t *) effp->priv;
+    double lo = 0, hi = sqr((double)SOX_SAMPLE_MIN) * silence->window_size;
+    double mid;
+
+    if (!sumAboveThreshold(effp, hi, threshold, unit))
+        return HUGE_VAL;
+    while ((mid = lo + (hi - lo) / 2) > lo && mid < hi) {
+        if (sumAboveThreshold(effp, mid, threshold, unit))
+            hi = mid;
+        else lo = mid;
+    }
+    return hi;
+}
+
 static int sox_silence_start(sox_effect_t * effp)
 {
     priv_t *silence = (priv_t *)effp->priv;
@@ -253,6 +302,11 @@ static int sox_silence_start(sox_effect_t * effp)
                                    effp->in_signal.channels);
     }
 
+    silence->start_sum_threshold = sumThreshold(effp,
+            silence->start_threshold, silence->start_unit);
+    silence->stop_sum_threshold = sumThreshold(effp,
+            silence->stop_threshold, silence->stop_unit);
+
     if (silence->start)
         silence->mode = SILENCE_TRIM;
     else
@@ -271,49 +325,35 @@ static int sox_silence_start(sox_effect_t * effp)
     return(SOX_SUCCESS);
 }
 
-static sox_bool aboveThreshold(sox_effect_t const * effp,
-    sox_sample_t value /* >= 0 */, double threshold, int unit)
-{
-  /* When scaling low bit data, noise values got scaled way up */
-  /* Only consider the original bits when looking for silence */
-  sox_sample_t masked_value = value & (-1 << (32 - effp->in_signal.precision));
-
-  double scaled_value = (double)masked_value / SOX_SAMPLE_MAX;
-
-  if (unit == '%')
-    scaled_value *= 100;
-  else if (unit == 'd')
-    scaled_value = linear_to_dB(scaled_value);
-
-  return scaled_value > threshold;
-}
-
-static sox_sample_t compute_rms(sox_effect_t * effp, sox_sample_t sample)
+/* Returns the number of ticks (wide samples), up to max_ticks, from the
+ * start of ibuf whose threshold state (any channel above, or, if `all', all
+ * channels above) is `above', and adds them to the RMS window.  As before,
+ * each of a tick's samples is tested before any of them enter the window. */
+static size_t run_length(priv_t * silence, sox_sample_t const * ibuf,
+    size_t channels, size_t max_ticks, double threshold, sox_bool all,
+    sox_bool above)
 {
-    priv_t * silence = (priv_t *) effp->priv;
-    double new_sum;
-    sox_sample_t rms;
-
-    new_sum = silence->rms_sum;
-    new_sum -= *silence->window_current;
-    new_sum += ((double)sample * (double)sample);
-
-    rms = sqrt(new_sum / silence->window_size);
-
-    return (rms);
-}
-
-static void update_rms(sox_effect_t * effp, sox_sample_t sample)
-{
-    priv_t * silence = (priv_t *) effp->priv;
+    double sum = silence->rms_sum, * current = silence->window_current;
+    size_t i, j, n;
 
-    silence->rms_sum -= *silence->window_current;
-    *silence->window_current = ((double)sample * (double)sample);
-    silence->rms_sum += *silence->window_current;
-
-    silence->window_current++;
-    if (silence->window_current >= silence->window_end)
-        silence->window_current = silence->window;
+    for (i = 0; i < max_ticks; i++, ibuf += channels)
+    {
+        for (n = j = 0; j < channels; j++)
+            n += sum - *current + sqr((double)ibuf[j]) >= threshold;
+        if ((all? n == channels : n != 0) != above)
+            break;
+        for (j = 0; j < channels; j++)
+        {
+            sum -= *current;
+            *current = sqr((double)ibuf[j]);
+            sum += *current;
+            if (++current >= silence->window_end)
+                current = silence->window;
+        }
+    }
+    silence->rms_sum = sum;
+    silence->window_current = current;
+    return i;
 }
 
 /* Process signed long samples from ibuf to obuf. */
@@ -322,8 +362,8 @@ static int sox_silence_flow(sox_effect_t * effp, const sox_sample_t *ibuf, sox_s
                     size_t *isamp, size_t *osamp)
 {
     priv_t * silence = (priv_t *) effp->priv;
-    int threshold;
-    size_t i, j;
+    size_t chans = effp->in_signal.channels;
+    size_t i, n;
     size_t nrOfTicks, nrOfInSamplesRead, nrOfOutSamplesWritten;
 
     nrOfInSamplesRead = 0;
@@ -342,53 +382,46 @@ silence_trim:
             nrOfTicks = min((*isamp-nrOfInSamplesRead),
                             (*osamp-nrOfOutSamplesWritten)) /
                            effp->in_signal.channels;
-            for(i = 0; i < nrOfTicks; i++)
+            for(i = 0; i < nrOfTicks; i += n)
             {
-                threshold = 0;
-                for (j = 0; j < effp->in_signal.channels; j++)
+                /* Skip a run of ticks below threshold */
+                n = run_length(silence, ibuf, chans, nrOfTicks - i,
+                        silence->start_sum_threshold, sox_false, sox_false);
+                if (n)
                 {
-                    threshold |= aboveThreshold(effp,
-                                                compute_rms(effp, ibuf[j]),
-                                                silence->start_threshold,
-                                                silence->start_unit);
+                    silence->start_holdoff_end = 0;
+                    ibuf += n * chans;
+                    nrOfInSamplesRead += n * chans;
+                    continue;
                 }
 
-                if (threshold)
+                /* Add a run above threshold to holdoff buffer, stopping
+                 * if it fills to the required duration. */
+                n = (silence->start_duration - min(silence->start_holdoff_end,
+                        silence->start_duration) + chans - 1) / chans;
+                n = run_length(silence, ibuf, chans,
+                        min(max(n, 1), nrOfTicks - i),
+                        silence->start_sum_threshold, sox_false, sox_true);
+                memcpy(silence->start_holdoff + silence->start_holdoff_end,
+                        ibuf, n * chans * sizeof(*ibuf));
+                silence->start_holdoff_end += n * chans;
+                ibuf += n * chans;
+                nrOfInSamplesRead += n * chans;
+
+                if (silence->start_holdoff_end >=
+                        silence->start_duration)
                 {
-                    /* Add to holdoff buffer */
-                    for (j = 0; j < effp->in_signal.channels; j++)
-                    {
-                        update_rms(effp, *ibuf);
-                        silence->start_holdoff[
-                            silence->start_holdoff_end++] = *ibuf++;
-                        nrOfInSamplesRead++;
-                    }
-
-                    if (silence->start_holdoff_end >=
-                            silence->start_duration)
+                    if (++silence->start_found_periods >=
+                            silence->start_periods)
                     {
-                        if (++silence->start_found_periods >=
-                                silence->start_periods)
-                        {
-                            silence->mode = SILENCE_TRIM_FLUSH;
-                            goto silence_trim_flush;
-                        }
-                        /* Trash holdoff buffer since its not
-                         * needed.  Start looking again.
-                         */
-                        silence->start_holdoff_offset = 0;
-                        silence->start_holdoff_end = 0;
+                        silence->mode = SILENCE_TRIM_FLUSH;
+                        goto silence_trim_flush;
                     }
-                }
-                else /* !above Threshold */
-                {
+                    /* Trash holdoff buffer since its not
+                     * needed.  Start looking again.
+                     */
+                    silence->start_holdoff_offset = 0;
                     silence->start_holdoff_end = 0;
-                    for (j = 0; j < effp->in_signal.channels; j++)
-                    {
-                        update_rms(effp, ibuf[j]);
-                    }
-                    ibuf += effp->in_signal.channels;
-                    nrOfInSamplesRead += effp->in_signal.channels;
                 }
             } /* for nrOfTicks */
             break;
@@ -460,61 +493,30 @@ silence_copy:
             if (silence->stop)
             {
                 /* Case A */
-                for(i = 0; i < nrOfTicks; i++)
+                for(i = 0; i < nrOfTicks; i += n)
                 {
-                    threshold = 1;
-                    for (j = 0; j < effp->in_signal.channels; j++)
-                    {
-                        threshold &= aboveThreshold(effp,
-                                                    compute_rms(effp, ibuf[j]),
-                                                    silence->stop_threshold,
-                                                    silence->stop_unit);
-                    }
-
-                    /* Case 1a
-                     * If above threshold, check to see if we where holding
-                     * off previously.  If so then flush this buffer.
-                     * We haven't incremented any pointers yet so nothing
-                     * is lost.
-                     *
-                     * If user wants to leave_silence, then we
-                     * were already copying the data and so no
-                     * need to flush the old data.  Just resume
-                     * copying as if we were not holding off.
+                    /* Case 2
+                     * Take a run of ticks not above threshold (stopping if
+                     * the hold off buffer fills to the required duration).
                      */
-                    if (threshold && silence->stop_holdoff_end
-                        && !silence->leave_silence)
-                    {
-                        silence->mode = SILENCE_COPY_FLUSH;
-                        goto silence_copy_flush;
-                    }
-                    /* Case 1b */
-                    else if (threshold)
-                    {
-                        /* Not holding off so copy into output buffer */
-                        for (j = 0; j < effp->in_signal.channels; j++)
-                        {
-                            update_rms(effp, *ibuf);
-                            *obuf++ = *ibuf++;
-                            nrOfInSamplesRead++;
-                            nrOfOutSamplesWritten++;
-                        }
-                    }
-                    /* Case 2 */
-                    else if (!threshold)
+                    n = (silence->stop_duration - min(silence->stop_holdoff_end,
+                            silence->stop_duration) + chans - 1) / chans;
+                    n = run_length(silence, ibuf, chans,
+                            min(max(n, 1), nrOfTicks - i),
+                            silence->stop_sum_threshold, sox_true, sox_false);
+                    if (n)
                     {
                         /* Add to holdoff buffer */
-                        for (j = 0; j < effp->in_signal.channels; j++)
-                        {
-                            update_rms(effp, *ibuf);
-                            if (silence->leave_silence) {
-                                *obuf++ = *ibuf;
-                                nrOfOutSamplesWritten++;
-                            }
-                            silence->stop_holdoff[
-                                silence->stop_holdoff_end++] = *ibuf++;
-                            nrOfInSamplesRead++;
+                        if (silence->leave_silence) {
+                            memcpy(obuf, ibuf, n * chans * sizeof(*obuf));
+                            obuf += n * chans;
+                            nrOfOutSamplesWritten += n * chans;
                         }
+                        memcpy(silence->stop_holdoff + silence->stop_holdoff_end,
+                                ibuf, n * chans * sizeof(*ibuf));
+                        silence->stop_holdoff_end += n * chans;
+                        ibuf += n * chans;
+                        nrOfInSamplesRead += n * chans;
 
                         /* Check if holdoff buffer is greater than duration
                          */
@@ -557,9 +559,38 @@ silence_copy:
                                 silence->mode = SILENCE_COPY_FLUSH;
                                 goto silence_copy_flush;
                             }
-                            break;
                         } /* Filled holdoff buffer */
+                        continue;
                     } /* Detected silence */
+
+                    /* Case 1a
+                     * The next tick is above threshold, so check to see if
+                     * we where holding off previously.  If so then flush
+                     * this buffer.  We haven't incremented any pointers yet
+                     * so nothing is lost.
+                     *
+                     * If user wants to leave_silence, then we
+                     * were already copying the data and so no
+                     * need to flush the old data.  Just resume
+                     * copying as if we were not holding off.
+                     */
+                    if (silence->stop_holdoff_end && !silence->leave_silence)
+                    {
+                        silence->mode = SILENCE_COPY_FLUSH;
+                        goto silence_copy_flush;
+                    }
+
+                    /* Case 1b
+                     * Not holding off so copy a run above threshold into
+                     * output buffer.
+                     */
+                    n = run_length(silence, ibuf, chans, nrOfTicks - i,
+                            silence->stop_sum_threshold, sox_true, sox_true);
+                    memcpy(obuf, ibuf, n * chans * sizeof(*obuf));
+                    obuf += n * chans;
+                    ibuf += n * chans;
+                    nrOfInSamplesRead += n * chans;
+                    nrOfOutSamplesWritten += n * chans;
                 } /* For # of samples */
             } /* Trimming off backend */
             else /* !(silence->stop) */
@@ -197,6 +197,8 @@ static sox_bool input_eof = sox_false;
 static sox_bool output_eof = sox_false;
 static sox_bool user_abort = sox_false;
 static sox_bool user_skip = sox_false;
+static sox_bool input_read_by_effect = sox_false;
+static sox_bool input_transcoded = sox_false;
 static sox_bool user_restart_eff = sox_false;
 static int success = 0;
 static sox_sample_t omax[2], omin[2];
@@ -520,7 +522,7 @@ static int combiner_drain(sox_effect_t *effp, sox_sample_t * obuf, size_t * osam
 
   if (is_serial(combine_method)) {
     while (sox_true) {
-      if (!user_skip)
+      if (!user_skip && !input_read_by_effect)
         olen = sox_read_wide(files[current_input]->ft, obuf, *osamp);
       if (olen == 0) {   /* If EOF, go to the next input file. */
         if (++current_input < input_count) {
@@ -1317,6 +1319,30 @@ static void optimize_trim(void)
       }
     }
   }
+  /* Similarly, "reverse" can read a seekable input file backwards itself,
+   * instead of first copying it all to temporary storage. */
+  else if (input_count == 1 && effects_chain->length > 1 && strcmp(effects_chain->effects[1][0].handler.name, "reverse") == 0) {
+    if (read_wide_samples == 0 && !input_read_by_effect && files[0]->volume == 1 &&
+        sox_reverse_set_input(&effects_chain->effects[1][0], files[0]->ft) == SOX_SUCCESS) {
+      input_read_by_effect = sox_true;
+      read_wide_samples = input_wide_samples;
+      lsx_debug("optimize_reverse successful");
+    }
+  }
+  /* And a scanning "gain" can read the input file twice. */
+  else if (input_count == 1 && effects_chain->length > 1 && (strcmp(effects_chain->effects[1][0].handler.name, "gain") == 0 || strcmp(effects_chain->effects[1][0].handler.name, "norm") == 0)) {
+    if (read_wide_samples == 0 && !input_read_by_effect && files[0]->volume == 1 &&
+        sox_gain_set_input(&effects_chain->effects[1][0], files[0]->ft) == SOX_SUCCESS)
+      lsx_debug("optimize_gain successful");
+  }
+  /* With no effects at all, raw u-law <-> A-law can be transcoded directly. */
+  else if (input_count == 1 && effects_chain->length == 2) {
+    if (read_wide_samples == 0 && !input_read_by_effect && files[0]->volume == 1 &&
+        sox_can_transcode(files[0]->ft, ofile->ft)) {
+      input_transcoded = sox_true;
+      lsx_debug("optimize_transcode successful");
+    }
+  }
 }
 
 static sox_bool overwrite_permitted(char const * filename)
@@ -1623,6 +1649,35 @@ static void set_combiner_and_output_encoding_parameters(void)
   }
 }
 
+/* The effects chain's flow, for input and output that are transcoded: */
+static int transcode(void)
+{
+  size_t len, bufsiz = sox_globals.bufsiz / combiner_signal.channels *
+    combiner_signal.channels;
+
+  do {
+    len = sox_transcode(files[0]->ft, ofile->ft, bufsiz);
+    read_wide_samples += len / combiner_signal.channels;
+    output_samples += len / combiner_signal.channels;
+  } while (len == bufsiz && update_status(sox_false, NULL) == SOX_SUCCESS);
+  update_status(sox_true, NULL);
+
+  if (len == bufsiz)  /* Stopped by the user */
+    return SOX_EOF;
+  if (ofile->ft->sox_errno) {
+    output_eof = sox_true;
+    lsx_fail("`%s' %s: %s", ofile->ft->filename,
+        ofile->ft->sox_errstr, sox_strerror(ofile->ft->sox_errno));
+    return SOX_EOF;
+  }
+  if (files[0]->ft->sox_errno)
+    lsx_fail("`%s' %s: %s", files[0]->ft->filename,
+        files[0]->ft->sox_errstr, sox_strerror(files[0]->ft->sox_errno));
+  input_eof = sox_true;
+  ++current_input;
+  return SOX_SUCCESS;
+}
+
 static int process(void)
 {         /* Input(s) -> Balancing -> Combiner -> Effects -> Output */
   int flow_status;
@@ -1659,7 +1714,8 @@ static int process(void)
 
   signal(SIGTERM, sigint); /* Stop gracefully, as soon as we possibly can. */
   signal(SIGINT , sigint); /* Either skip current input or behave as SIGTERM. */
-  flow_status = sox_flow_effects(effects_chain, update_status, NULL);
+  flow_status = input_transcoded? transcode() :
+    sox_flow_effects(effects_chain, update_status, NULL);
 
   /* Don't return SOX_EOF if
    * 1) input reach EOF and there are more input files to process or
@@ -1818,6 +1874,8 @@ static void usage(char const * message)
 "-S, --show-progress      Display progress while processing audio data",
 "--single-threaded        Disable parallel effects channels processing",
 "--temp DIRECTORY         Specify the directory to use for temporary files",
+"--temp-memory BYTES      Memory to use for temporary data before using temporary",
+"                         files (default 67108864)",
 "--version                Display version number of SoX and exit",
 "-V[LEVEL]                Increment or set verbosity level (default 2); levels:",
 "                           1: failure messages",
@@ -2037,6 +2095,7 @@ static struct option const long_options[] = {
   {"clobber"         ,       no_argument, NULL, 0},
   {"no-clobber"      ,       no_argument, NULL, 0},
   {"multi-threaded"  ,       no_argument, NULL, 0},
+  {"temp-memory"     , required_argument, NULL, 0},
 
   {"bits"            , required_argument, NULL, 'b'},
   {"channels"        , required_argument, NULL, 'c'},
@@ -2134,6 +2193,7 @@ static char parse_gopts_and_fopts(file_t * f, int argc, char **argv)
     int c, option_index;
     int i; /* sscanf silently accepts negative numbers for %u :( */
     char dummy;     /* To check for extraneous chars in optarg. */
+    double d;
 
     switch (c=lsx_getopt_long(argc, argv, getoptstr, long_options, &option_index)) {
     case -1:        /* @ one of: file-name, effect name, end of arg-list. */
@@ -2212,6 +2272,14 @@ static char parse_gopts_and_fopts(file_t * f, int argc, char **argv)
       case 22: no_clobber = sox_false; break;
       case 23: no_clobber = sox_true; break;
       case 24: single_threaded = sox_false; break;
+
+      case 25:
+        if (sscanf(lsx_optarg, "%lf %c", &d, &dummy) != 1 || d < 0) {
+          lsx_fail("Temporary memory size `%s' must be >= 0", lsx_optarg);
+          exit(1);
+        }
+        sox_globals.tmp_mem_max = d < (size_t)-1? (size_t)d : (size_t)-1;
+        break;
       }
       break;
 
@@ -190,6 +190,7 @@ typedef struct { /* Global parameters (for effects & formats) */
   char const * subsystem;
   char       * tmp_path;
   sox_bool     use_magic;
+  size_t       tmp_mem_max; /* Memory for temporary data before using a file */
 } sox_globals_t;
 extern sox_globals_t sox_globals;
 
@@ -567,6 +568,29 @@ void sox_trim_clear_start(sox_effect_t * effp);
 size_t sox_crop_get_start(sox_effect_t * effp);
 void sox_crop_clear_start(sox_effect_t * effp);
 
+/* The following routine is unique to the reverse effect.  If the reverse
+ * effect is the first effect and the input file is seekable, it may be given
+ * the file (before any audio has been read from it); it then reads the file
+ * backwards itself, and nothing should be passed to its flow function.
+ * Returns SOX_SUCCESS if the effect has taken the file.
+ */
+int sox_reverse_set_input(sox_effect_t * effp, sox_format_t * ft);
+
+/* Likewise, a scanning gain effect (e.g. gain -n, norm) may be given its
+ * seekable input file; it then measures the audio as it flows, and reads
+ * the file again in its drain, instead of holding on to the audio.
+ */
+int sox_gain_set_input(sox_effect_t * effp, sox_format_t * ft);
+
+/* And with nothing in between, raw u-law and A-law input and output (see
+ * sox_can_transcode) may be transcoded byte for byte, without going through
+ * sox_sample_t.  sox_transcode copies up to len samples (whole wide samples)
+ * and returns the number written: fewer at the end of the input, or if
+ * writing fails.
+ */
+sox_bool sox_can_transcode(sox_format_t const * ift, sox_format_t const * oft);
+size_t sox_transcode(sox_format_t * ift, sox_format_t * oft, size_t len);
+
 typedef int (* sox_playlist_callback_t)(void *, char *);
 sox_bool sox_is_playlist(char const * filename);
 int sox_parse_playlist(sox_playlist_callback_t callback, void * p, char const * const listname);
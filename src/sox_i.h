@@ -60,6 +60,21 @@ assert_static(sizeof(off_t) == _FILE_OFFSET_BITS >> 3, OFF_T_BUILD_PROBLEM);
 
 FILE * lsx_tmpfile(void);
 
+/* Temporary data store: held in memory up to sox_globals.tmp_mem_max bytes,
+ * then moved to an lsx_tmpfile (which, where possible, is memory-mapped for
+ * reading).  Zero-initialise before first use. */
+typedef struct {
+  char     * mem;      /* In-memory data; NULL once spilled */
+  size_t     mem_size; /* Bytes allocated at mem */
+  FILE     * file;     /* Non-NULL once spilled */
+  uint64_t   length;   /* Total bytes written */
+  char     * map;      /* Mapping of file, or NULL */
+  size_t     map_size; /* Bytes mapped at map */
+} lsx_tmpbuf_t;
+int lsx_tmpbuf_write(lsx_tmpbuf_t * t, void const * data, size_t len);
+size_t lsx_tmpbuf_read(lsx_tmpbuf_t * t, uint64_t offset, void * data, size_t len);
+void lsx_tmpbuf_close(lsx_tmpbuf_t * t);
+
 void lsx_debug_more(char const * fmt, ...) PRINTF;
 void lsx_debug_most(char const * fmt, ...) PRINTF;
 
@@ -77,6 +92,16 @@ void lsx_generate_wave_table(
     double min,         /* Minimum value on the y-axis. (e.g. -1) */
     double max,         /* Maximum value on the y-axis. (e.g. +1) */
     double phase);      /* Phase at 1st point; 0..2pi. (e.g. pi/2 for cosine) */
+/* Copy n points of such a table, from *phase (wrapping round), to buf, and
+ * advance *phase.
+ */
+void lsx_read_wave_table(
+    sox_data_t data_type,
+    void const * table,
+    size_t table_size,
+    size_t * phase,
+    void * buf,
+    size_t n);
 char const * lsx_parsesamples(sox_rate_t rate, const char *str, size_t *samples, int def);
 int lsx_parse_note(char const * text, char * * end_ptr);
 double lsx_parse_frequency_k(char const * text, char * * end_ptr, int key);
@@ -96,6 +121,11 @@ void lsx_safe_rdft(int len, int type, double * d);
 void lsx_safe_cdft(int len, int type, double * d);
 void lsx_power_spectrum(int n, double const * in, double * out);
 void lsx_power_spectrum_f(int n, float const * in, float * out);
+int lsx_overlap_dft_len(size_t n, size_t search, size_t stride);
+typedef double (* lsx_overlap_difference_t)(void * data, size_t pos);
+size_t lsx_best_overlap_dft(int dft_len, double * x, double * y,
+    size_t n, size_t search, size_t stride,
+    lsx_overlap_difference_t difference, void * data);
 void lsx_apply_hann_f(float h[], const int num_points);
 void lsx_apply_hann(double h[], const int num_points);
 void lsx_apply_hamming(double h[], const int num_points);
@@ -251,6 +281,33 @@ int lsx_flow_copy(sox_effect_t * effp, const sox_sample_t * ibuf,
     sox_sample_t * obuf, size_t * isamp, size_t * osamp);
 int lsx_usage(sox_effect_t * effp);
 char * lsx_usage_lines(char * * usage, char const * const * lines, size_t n);
+sox_bool lsx_is_seek_exact(sox_format_t const * ft);
+sox_bool lsx_biquad_fuse(sox_effect_t * effp, sox_effect_t * next);
+
+/* Samples held in an lsx_tmpbuf_t, packed to the given precision (so long
+ * as that turns out to be exact) */
+typedef struct {
+  lsx_tmpbuf_t tmp;
+  unsigned     bytes;  /* Per sample */
+} lsx_tmpsamples_t;
+#define lsx_tmpsamples_length(t) ((t)->tmp.length / (t)->bytes)
+#define lsx_tmpsamples_close(t) lsx_tmpbuf_close(&(t)->tmp)
+void lsx_tmpsamples_init(lsx_tmpsamples_t * t, unsigned precision);
+int lsx_tmpsamples_write(lsx_tmpsamples_t * t, sox_sample_t const * s, size_t len);
+size_t lsx_tmpsamples_read(lsx_tmpsamples_t * t, uint64_t pos, sox_sample_t * s, size_t len);
+/* A delay line for the modulated-delay effects (chorus, flanger, phaser).
+ * Samples are written a block at a time, directly after max_delay samples of
+ * history; so, with x as returned by lsx_delay_line_write, x[t - d] is x[t]
+ * delayed by d (for d <= max_delay), with no modulo arithmetic needed. */
+#define LSX_DELAY_LINE_BLOCK_LEN 1024 /* Any n up to this can be written */
+typedef struct {
+  double * buf;
+  size_t   max_delay, block_len, pos;
+} lsx_delay_line_t;
+void lsx_delay_line_create(lsx_delay_line_t * p, size_t max_delay);
+double * lsx_delay_line_write(lsx_delay_line_t * p, size_t n);
+#define lsx_delay_line_delete(p) free((p)->buf)
+
 #define EFFECT(f) extern sox_effect_handler_t const * lsx_##f##_effect_fn(void);
 #include "effects.h"
 #undef EFFECT
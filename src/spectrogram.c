@@ -25,8 +25,10 @@
 #include <assert.h>
 #include <math.h>
 #include <png.h>
+#include <zlib.h>
 
 #define MAX_FFT_SIZE 4096
+#define MAX_BATCH 64     /* DFTs done (in parallel) at a time */
 #define is_p2(x) !(x & (x - 1))
 
 typedef enum {Window_Hann, Window_Hamming, Window_Bartlett, Window_Rectangular, Window_Kaiser} win_type_t;
@@ -56,9 +58,12 @@ typedef struct {
   int        dft_size, step_size, block_steps, block_num, rows, cols, read;
   int        x_size, end, end_min, last_end;
   sox_bool   truncated;
-  double     buf[MAX_FFT_SIZE], dft_buf[MAX_FFT_SIZE], window[MAX_FFT_SIZE];
+  double     buf[MAX_FFT_SIZE], window[MAX_FFT_SIZE];
   double     block_norm, max, magnitudes[(MAX_FFT_SIZE>>1) + 1];
-  float      * dBfs;
+  float      * dBfs;          /* x_size columns of rows values */
+  double     * batch, * batch_power;
+  int        batch_len, * dft_br;
+  double     * dft_sc;        /* Private so that batches can run in parallel */
 } priv_t;
 
 #define secs(cols) \
@@ -221,8 +226,11 @@ static int start(sox_effect_t * effp)
    int y = max(32, (p->Y_size? p->Y_size : 550) / effp->in_signal.channels - 2);
    for (p->dft_size = 128; p->dft_size <= y; p->dft_size <<= 1);
   }
-  if (is_p2(p->dft_size) && !effp->flow)
-    lsx_safe_rdft(p->dft_size, 1, p->dft_buf);
+  if (is_p2(p->dft_size)) {
+    p->dft_br = lsx_calloc(dft_br_len(p->dft_size), sizeof(*p->dft_br));
+    p->dft_sc = lsx_calloc(dft_sc_len(p->dft_size), sizeof(*p->dft_sc));
+    lsx_rdft(p->dft_size, 1, p->buf, p->dft_br, p->dft_sc); /* Make tables */
+  }
   lsx_debug("duration=%g x_size=%i pixels_per_sec=%g dft_size=%i", duration, p->x_size, pixels_per_sec, p->dft_size);
 
   p->end = p->dft_size;
@@ -240,6 +248,9 @@ static int start(sox_effect_t * effp)
   lsx_debug("step_size=%i block_steps=%i", p->step_size, p->block_steps);
   p->max = -p->dB_range;
   p->read = (p->step_size - p->dft_size) / 2;
+  p->dBfs = lsx_malloc(p->x_size * p->rows * sizeof(*p->dBfs));
+  p->batch = lsx_malloc(MAX_BATCH * p->dft_size * sizeof(*p->batch));
+  p->batch_power = lsx_malloc(MAX_BATCH * p->rows * sizeof(*p->batch_power));
   return SOX_SUCCESS;
 }
 
@@ -255,7 +266,6 @@ static int do_column(sox_effect_t * effp)
     return p->truncate? SOX_EOF : SOX_SUCCESS;
   }
   ++p->cols;
-  p->dBfs = lsx_realloc(p->dBfs, p->cols * p->rows * sizeof(*p->dBfs));
   for (i = 0; i < p->rows; ++i) {
     double dBfs = 10 * log10(p->magnitudes[i] * p->block_norm);
     p->dBfs[(p->cols - 1) * p->rows + i] = dBfs + p->gain;
@@ -266,6 +276,43 @@ static int do_column(sox_effect_t * effp)
   return SOX_SUCCESS;
 }
 
+/* Find the power spectra of the batched (windowed) blocks, then, in order,
+ * add them up into columns. */
+static int do_batch(sox_effect_t * effp)
+{
+  priv_t * p = (priv_t *)effp->priv;
+  int i, n = p->batch_len;
+
+  p->batch_len = 0;
+#ifdef HAVE_OPENMP
+  #pragma omp parallel for if (n > 1)
+#endif
+  for (i = 0; i < n; ++i) {
+    double * in = p->batch + i * p->dft_size, * out = p->batch_power + i * p->rows;
+    int j;
+    if (is_p2(p->dft_size)) {
+      lsx_rdft(p->dft_size, 1, in, p->dft_br, p->dft_sc);
+      out[0] = sqr(in[0]);
+      for (j = 1; j < p->dft_size >> 1; ++j)
+        out[j] = sqr(in[2*j]) + sqr(in[2*j+1]);
+      out[p->dft_size >> 1] = sqr(in[1]);
+    }
+    else {
+      memset(out, 0, p->rows * sizeof(*out));
+      rdft_p(*p->shared_ptr, in, out, p->dft_size);
+    }
+  }
+  for (i = 0; i < n && !p->truncated; ++i) {
+    double const * power = p->batch_power + i * p->rows;
+    int j;
+    for (j = 0; j < p->rows; ++j)
+      p->magnitudes[j] += power[j];
+    if (++p->block_num == p->block_steps && do_column(effp) == SOX_EOF)
+      return SOX_EOF;
+  }
+  return SOX_SUCCESS;
+}
+
 static int flow(sox_effect_t * effp,
     const sox_sample_t * ibuf, sox_sample_t * obuf,
     size_t * isamp, size_t * osamp)
@@ -299,19 +346,12 @@ static int flow(sox_effect_t * effp,
 
     if ((p->end = max(p->end, p->end_min)) != p->last_end)
       make_window(p, p->last_end = p->end);
-    for (i = 0; i < p->dft_size; ++i) p->dft_buf[i] = p->buf[i] * p->window[i];
-    if (is_p2(p->dft_size)) {
-      lsx_safe_rdft(p->dft_size, 1, p->dft_buf);
-      p->magnitudes[0] += sqr(p->dft_buf[0]);
-      for (i = 1; i < p->dft_size >> 1; ++i)
-        p->magnitudes[i] += sqr(p->dft_buf[2*i]) + sqr(p->dft_buf[2*i+1]);
-      p->magnitudes[p->dft_size >> 1] += sqr(p->dft_buf[1]);
-    }
-    else rdft_p(*p->shared_ptr, p->dft_buf, p->magnitudes, p->dft_size);
-    if (++p->block_num == p->block_steps && do_column(effp) == SOX_EOF)
+    for (i = 0; i < p->dft_size; ++i)
+      p->batch[p->batch_len * p->dft_size + i] = p->buf[i] * p->window[i];
+    if (++p->batch_len == MAX_BATCH && do_batch(effp) == SOX_EOF)
       return SOX_EOF;
   }
-  return SOX_SUCCESS;
+  return do_batch(effp);
 }
 
 static int drain(sox_effect_t * effp, sox_sample_t * obuf_, size_t * osamp)
@@ -596,11 +636,20 @@ static int stop(sox_effect_t * effp)
 error: png_destroy_write_struct(&png, &png_info);
   free(png_rows);
   free(pixels);
-  free(p->dBfs);
   return SOX_SUCCESS;
 }
 
-static int end(sox_effect_t * effp) {return effp->flow? SOX_SUCCESS:stop(effp);}
+static int end(sox_effect_t * effp)
+{
+  priv_t * p = (priv_t *)effp->priv;
+  int result = effp->flow? SOX_SUCCESS : stop(effp); /* stop uses all flows */
+  free(p->dBfs);
+  free(p->batch);
+  free(p->batch_power);
+  free(p->dft_br);
+  free(p->dft_sc);
+  return result;
+}
 
 sox_effect_handler_t const * lsx_spectrogram_effect_fn(void)
 {
@@ -29,15 +29,40 @@ static double difference(
   return diff;
 }
 
+typedef struct {sox_sample_t const * f1, * f2; size_t n, channels;} dft_search_t;
+
+static double dft_difference(void * data, size_t i)
+{
+  dft_search_t * s = (dft_search_t *)data;
+  return difference(s->f2 + s->channels * i, s->f1, s->n);
+}
+
 /* Find where the two segments are most alike over the overlap period. */
 static size_t best_overlap_position(sox_sample_t const * f1,
     sox_sample_t const * f2, size_t overlap, size_t search, size_t channels)
 {
-  size_t i, best_pos = 0;
-  double diff, least_diff = difference(f2, f1, channels * overlap);
+  size_t i, n = channels * overlap, best_pos = 0;
+  int dft_len = lsx_overlap_dft_len(n, search, channels);
+  double diff, least_diff;
 
+  if (dft_len) { /* Cheaper to search by DFT cross-correlation */
+    size_t len = channels * (search - 1) + n;
+    double * x = lsx_malloc((2 * dft_len + search) * sizeof(*x));
+    double * y = x + dft_len + search;
+    dft_search_t s;
+    for (i = 0; i < len; ++i)
+      x[i] = f2[i];
+    for (i = 0; i < n; ++i)
+      y[i] = f1[i];
+    s.f1 = f1, s.f2 = f2, s.n = n, s.channels = channels;
+    best_pos = lsx_best_overlap_dft(dft_len, x, y, n, search, channels,
+        dft_difference, &s);
+    free(x);
+    return best_pos;
+  }
+  least_diff = difference(f2, f1, n);
   for (i = 1; i < search; ++i) { /* linear search */
-    diff = difference(f2 + channels * i, f1, channels * overlap);
+    diff = difference(f2 + channels * i, f1, n);
     if (diff < least_diff)
       least_diff = diff, best_pos = i;
   }
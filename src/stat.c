@@ -134,6 +134,7 @@ static int sox_stat_flow(sox_effect_t * effp, const sox_sample_t *ibuf, sox_samp
   priv_t * stat = (priv_t *) effp->priv;
   int done, x, len = min(*isamp, *osamp);
   short count = 0;
+  double min, max, sum1, sum2, asum, dmin, dmax, dsum1, dsum2, last;
 
   if (len) {
     if (stat->read == 0)          /* 1st sample */
@@ -152,43 +153,50 @@ static int sox_stat_flow(sox_effect_t * effp, const sox_sample_t *ibuf, sox_samp
       }
     }
 
+    if (stat->volume == 2) for (done = 0; done < len; done++) {
+      fprintf(stderr,"%08lx ",(long)ibuf[done]);
+      if (count++ == 5) {
+          fprintf(stderr,"\n");
+          count = 0;
+      }
+    }
+    memcpy(obuf, ibuf, len * sizeof(*obuf));
+
+    /* Keep the running values in locals, so that they can stay in registers */
+    min = stat->min, max = stat->max, last = stat->last;
+    sum1 = stat->sum1, sum2 = stat->sum2, asum = stat->asum;
+    dmin = stat->dmin, dmax = stat->dmax, dsum1 = stat->dsum1, dsum2 = stat->dsum2;
     for (done = 0; done < len; done++) {
-      long lsamp = *ibuf++;
+      long lsamp = ibuf[done];
       double delta, samp = (double)lsamp / stat->scale;
       /* work in scaled levels for both sample and delta */
       stat->bin[(lsamp >> 30) + 2]++;
-      *obuf++ = lsamp;
-
-      if (stat->volume == 2) {
-          fprintf(stderr,"%08lx ",lsamp);
-          if (count++ == 5) {
-              fprintf(stderr,"\n");
-              count = 0;
-          }
-      }
 
       /* update min/max */
-      if (stat->min > samp)
-        stat->min = samp;
-      else if (stat->max < samp)
-        stat->max = samp;
-      stat->mid = stat->min / 2 + stat->max / 2;
-
-      stat->sum1 += samp;
-      stat->sum2 += samp*samp;
-      stat->asum += fabs(samp);
-
-      delta = fabs(samp - stat->last);
-      if (delta < stat->dmin)
-        stat->dmin = delta;
-      else if (delta > stat->dmax)
-        stat->dmax = delta;
-
-      stat->dsum1 += delta;
-      stat->dsum2 += delta*delta;
-
-      stat->last = samp;
+      if (min > samp)
+        min = samp;
+      else if (max < samp)
+        max = samp;
+
+      sum1 += samp;
+      sum2 += samp*samp;
+      asum += fabs(samp);
+
+      delta = fabs(samp - last);
+      if (delta < dmin)
+        dmin = delta;
+      else if (delta > dmax)
+        dmax = delta;
+
+      dsum1 += delta;
+      dsum2 += delta*delta;
+
+      last = samp;
     }
+    stat->min = min, stat->max = max, stat->last = last;
+    stat->sum1 = sum1, stat->sum2 = sum2, stat->asum = asum;
+    stat->dmin = dmin, stat->dmax = dmax, stat->dsum1 = dsum1, stat->dsum2 = dsum2;
+    stat->mid = min / 2 + max / 2; /* Depends only on the final min & max */
     stat->read += len;
   }
 
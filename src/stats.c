@@ -20,14 +20,20 @@
 #include <ctype.h>
 #include <string.h>
 
+typedef struct {
+  double    last, sigma_x, sigma_x2, avg_sigma_x2, min_sigma_x2, max_sigma_x2;
+  double    min, max, min_run, min_runs, max_run, max_runs;
+  off_t     min_count, max_count;
+  uint32_t  mask;
+} chan_t;
+
 typedef struct {
   int       scale_bits, hex_bits;
   double    time_constant, scale;
 
-  double    last, sigma_x, sigma_x2, avg_sigma_x2, min_sigma_x2, max_sigma_x2;
-  double    min, max, mult, min_run, min_runs, max_run, max_runs;
-  off_t     num_samples, tc_samples, min_count, max_count;
-  uint32_t  mask;
+  double    mult;
+  off_t     num_samples, tc_samples; /* Per channel */
+  chan_t    * chans;
 } priv_t;
 
 static int getopts(sox_effect_t * effp, int argc, char **argv)
@@ -52,26 +58,26 @@ static int getopts(sox_effect_t * effp, int argc, char **argv)
 static int start(sox_effect_t * effp)
 {
   priv_t * p = (priv_t *)effp->priv;
+  unsigned i;
 
-  p->last = 0;
   p->mult = exp((-1 / p->time_constant / effp->in_signal.rate));
   p->tc_samples = 5 * p->time_constant * effp->in_signal.rate + .5;
-  p->sigma_x = p->sigma_x2 = p->avg_sigma_x2 = p->max_sigma_x2 = 0;
-  p->min = p->min_sigma_x2 = 2;
-  p->max = -p->min;
   p->num_samples = 0;
-  p->mask = 0;
+  p->chans = lsx_calloc(effp->in_signal.channels, sizeof(*p->chans));
+  for (i = 0; i < effp->in_signal.channels; ++i) {
+    chan_t * c = &p->chans[i];
+    c->min = c->min_sigma_x2 = 2;
+    c->max = -c->min;
+  }
   return SOX_SUCCESS;
 }
 
-static int flow(sox_effect_t * effp, const sox_sample_t * ibuf,
-    sox_sample_t * obuf, size_t * ilen, size_t * olen)
-{
-  priv_t * p = (priv_t *)effp->priv;
-  size_t len = *ilen = *olen = min(*ilen, *olen);
-  memcpy(obuf, ibuf, len * sizeof(*obuf));
+#define BLOCK_LEN 256 /* Wide samples */
 
-  for (; len--; ++ibuf, ++p->num_samples) {
+/* Min & max tracking, for one channel of interleaved samples: */
+static void min_max(chan_t * p, const sox_sample_t * ibuf, size_t stride, size_t len)
+{
+  for (; len--; ibuf += stride) {
     double d = SOX_SAMPLE_TO_FLOAT_64BIT(*ibuf,);
 
     if (d < p->min)
@@ -92,18 +98,88 @@ static int flow(sox_effect_t * effp, const sox_sample_t * ibuf,
     else if (p->last == p->max)
       p->max_runs += sqr(p->max_run);
 
-    p->sigma_x += d;
-    p->sigma_x2 += sqr(d);
-    p->avg_sigma_x2 = p->avg_sigma_x2 * p->mult + (1 - p->mult) * sqr(d);
-
-    if (p->num_samples >= p->tc_samples) {
-      if (p->avg_sigma_x2 > p->max_sigma_x2)
-        p->max_sigma_x2 = p->avg_sigma_x2;
-      if (p->avg_sigma_x2 < p->min_sigma_x2)
-        p->min_sigma_x2 = p->avg_sigma_x2;
-    }
     p->last = d;
-    p->mask |= *ibuf;
+  }
+}
+
+/* As min_max, but first reduce the block (cheaply); only if it reaches the
+ * current min or max need it be looked at sample by sample. */
+static void min_max_block(chan_t * p, const sox_sample_t * ibuf, size_t stride, size_t len)
+{
+  sox_sample_t lo = SOX_SAMPLE_MAX, hi = SOX_SAMPLE_MIN;
+  uint32_t mask = 0;
+  size_t i;
+
+  for (i = 0; i < len * stride; i += stride) {
+    lo = min(lo, ibuf[i]);
+    hi = max(hi, ibuf[i]);
+    mask |= ibuf[i];
+  }
+  p->mask |= mask;
+  if (SOX_SAMPLE_TO_FLOAT_64BIT(lo,) > p->min && SOX_SAMPLE_TO_FLOAT_64BIT(hi,) < p->max) {
+    if (p->last == p->min)            /* Any min or max run ends here */
+      p->min_runs += sqr(p->min_run);
+    if (p->last == p->max)
+      p->max_runs += sqr(p->max_run);
+    p->last = SOX_SAMPLE_TO_FLOAT_64BIT(ibuf[(len - 1) * stride],);
+  }
+  else min_max(p, ibuf, stride, len);
+}
+
+/* The sums for `width' (1 or 2) adjacent channels; with two, the channels'
+ * sums (which must be made in sample order, to keep results exact) are
+ * independent so can proceed in parallel.  The sliding average is tracked
+ * for the first k wide samples, and also peak-held for the rest. */
+static void sums(chan_t * p, unsigned width, double mult,
+    const sox_sample_t * ibuf, size_t stride, size_t len, size_t k)
+{
+  double sigma_x[2], sigma_x2[2], avg[2], min_sigma_x2[2], max_sigma_x2[2];
+  size_t i;
+  unsigned j;
+
+  for (j = 0; j < width; ++j) {
+    sigma_x[j] = p[j].sigma_x, sigma_x2[j] = p[j].sigma_x2;
+    avg[j] = p[j].avg_sigma_x2;
+    min_sigma_x2[j] = p[j].min_sigma_x2, max_sigma_x2[j] = p[j].max_sigma_x2;
+  }
+  for (i = 0; i < k; ++i, ibuf += stride) for (j = 0; j < width; ++j) {
+    double d = SOX_SAMPLE_TO_FLOAT_64BIT(ibuf[j],);
+    sigma_x[j] += d;
+    sigma_x2[j] += sqr(d);
+    avg[j] = avg[j] * mult + (1 - mult) * sqr(d);
+  }
+  for (; i < len; ++i, ibuf += stride) for (j = 0; j < width; ++j) {
+    double d = SOX_SAMPLE_TO_FLOAT_64BIT(ibuf[j],);
+    sigma_x[j] += d;
+    sigma_x2[j] += sqr(d);
+    avg[j] = avg[j] * mult + (1 - mult) * sqr(d);
+    max_sigma_x2[j] = max(max_sigma_x2[j], avg[j]);
+    min_sigma_x2[j] = min(min_sigma_x2[j], avg[j]);
+  }
+  for (j = 0; j < width; ++j) {
+    p[j].sigma_x = sigma_x[j], p[j].sigma_x2 = sigma_x2[j];
+    p[j].avg_sigma_x2 = avg[j];
+    p[j].min_sigma_x2 = min_sigma_x2[j], p[j].max_sigma_x2 = max_sigma_x2[j];
+  }
+}
+
+static int flow(sox_effect_t * effp, const sox_sample_t * ibuf,
+    sox_sample_t * obuf, size_t * ilen, size_t * olen)
+{
+  priv_t * p = (priv_t *)effp->priv;
+  size_t chans = effp->in_signal.channels, c, k, n;
+  size_t len = *ilen = *olen = min(*ilen, *olen) / chans * chans;
+  memcpy(obuf, ibuf, len * sizeof(*obuf));
+
+  for (; len; len -= n * chans, ibuf += n * chans, p->num_samples += n) {
+    n = min(len / chans, BLOCK_LEN);
+    k = min(max(p->tc_samples - p->num_samples, 0), (off_t)n);
+    for (c = 0; c < chans; ++c)
+      min_max_block(&p->chans[c], ibuf + c, chans, n);
+    for (c = 0; c + 1 < chans; c += 2)
+      sums(&p->chans[c], 2u, p->mult, ibuf + c, chans, n, k);
+    if (c < chans)
+      sums(&p->chans[c], 1u, p->mult, ibuf + c, chans, n, k);
   }
   return SOX_SUCCESS;
 }
@@ -111,11 +187,15 @@ static int flow(sox_effect_t * effp, const sox_sample_t * ibuf,
 static int drain(sox_effect_t * effp, sox_sample_t * obuf, size_t * olen)
 {
   priv_t * p = (priv_t *)effp->priv;
-
-  if (p->last == p->min)
-    p->min_runs += sqr(p->min_run);
-  if (p->last == p->max)
-    p->max_runs += sqr(p->max_run);
+  unsigned i;
+
+  for (i = 0; i < effp->in_signal.channels; ++i) {
+    chan_t * c = &p->chans[i];
+    if (c->last == c->min)
+      c->min_runs += sqr(c->min_run);
+    if (c->last == c->max)
+      c->max_runs += sqr(c->max_run);
+  }
 
   (void)obuf, *olen = 0;
   return SOX_SUCCESS;
@@ -158,139 +238,139 @@ static void output(priv_t const * p, double x)
 static int stop(sox_effect_t * effp)
 {
   priv_t * p = (priv_t *)effp->priv;
+  unsigned chans = effp->in_signal.channels;
+  double min_runs = 0, max_count = 0, min = 2, max = -2, max_sigma_x = 0, sigma_x = 0, sigma_x2 = 0, min_sigma_x2 = 2, max_sigma_x2 = 0, avg_peak = 0;
+  off_t num_samples = 0, min_count = 0, max_runs = 0;
+  uint32_t mask = 0;
+  unsigned b1, b2, i, n = chans > 1 ? chans : 0;
+
+  for (i = 0; i < chans; ++i) {
+    chan_t * q = &p->chans[i];
+    min = min(min, q->min);
+    max = max(max, q->max);
+    min_sigma_x2 = min(min_sigma_x2, q->min_sigma_x2);
+    max_sigma_x2 = max(max_sigma_x2, q->max_sigma_x2);
+    sigma_x += q->sigma_x;
+    sigma_x2 += q->sigma_x2;
+    num_samples += p->num_samples;
+    mask |= q->mask;
+    if (fabs(q->sigma_x) > fabs(max_sigma_x))
+      max_sigma_x = q->sigma_x;
+    min_count += q->min_count;
+    min_runs += q->min_runs;
+    max_count += q->max_count;
+    max_runs += q->max_runs;
+    avg_peak += max(-q->min, q->max);
+  }
+  avg_peak /= chans;
 
-  if (!effp->flow) {
-    double min_runs = 0, max_count = 0, min = 2, max = -2, max_sigma_x = 0, sigma_x = 0, sigma_x2 = 0, min_sigma_x2 = 2, max_sigma_x2 = 0, avg_peak = 0;
-    off_t num_samples = 0, min_count = 0, max_runs = 0;
-    uint32_t mask = 0;
-    unsigned b1, b2, i, n = effp->flows > 1 ? effp->flows : 0;
-
-    for (i = 0; i < effp->flows; ++i) {
-      priv_t * q = (priv_t *)(effp - effp->flow + i)->priv;
-      min = min(min, q->min);
-      max = max(max, q->max);
-      min_sigma_x2 = min(min_sigma_x2, q->min_sigma_x2);
-      max_sigma_x2 = max(max_sigma_x2, q->max_sigma_x2);
-      sigma_x += q->sigma_x;
-      sigma_x2 += q->sigma_x2;
-      num_samples += q->num_samples;
-      mask |= q->mask;
-      if (fabs(q->sigma_x) > fabs(max_sigma_x))
-        max_sigma_x = q->sigma_x;
-      min_count += q->min_count;
-      min_runs += q->min_runs;
-      max_count += q->max_count;
-      max_runs += q->max_runs;
-      avg_peak += max(-q->min, q->max);
-    }
-    avg_peak /= effp->flows;
-
-    if (!num_samples) {
-      lsx_warn("no audio");
-      return SOX_SUCCESS;
-    }
+  if (!num_samples) {
+    lsx_warn("no audio");
+    free(p->chans);
+    return SOX_SUCCESS;
+  }
 
-    if (n == 2)
-      fprintf(stderr, "             Overall     Left      Right\n");
-    else if (n) {
-      fprintf(stderr, "             Overall");
-      for (i = 0; i < n; ++i)
-        fprintf(stderr, "     Ch%-3i", i + 1);
-      fprintf(stderr, "\n");
-    }
+  if (n == 2)
+    fprintf(stderr, "             Overall     Left      Right\n");
+  else if (n) {
+    fprintf(stderr, "             Overall");
+    for (i = 0; i < n; ++i)
+      fprintf(stderr, "     Ch%-3i", i + 1);
+    fprintf(stderr, "\n");
+  }
 
-    fprintf(stderr, "DC offset ");
-    output(p, max_sigma_x / p->num_samples);
-    for (i = 0; i < n; ++i) {
-      priv_t * q = (priv_t *)(effp - effp->flow + i)->priv;
-      output(p, q->sigma_x / q->num_samples);
-    }
+  fprintf(stderr, "DC offset ");
+  output(p, max_sigma_x / p->num_samples);
+  for (i = 0; i < n; ++i) {
+    chan_t * q = &p->chans[i];
+    output(p, q->sigma_x / p->num_samples);
+  }
 
-    fprintf(stderr, "\nMin level ");
-    output(p, min);
-    for (i = 0; i < n; ++i) {
-      priv_t * q = (priv_t *)(effp - effp->flow + i)->priv;
-      output(p, q->min);
-    }
+  fprintf(stderr, "\nMin level ");
+  output(p, min);
+  for (i = 0; i < n; ++i) {
+    chan_t * q = &p->chans[i];
+    output(p, q->min);
+  }
 
-    fprintf(stderr, "\nMax level ");
-    output(p, max);
-    for (i = 0; i < n; ++i) {
-      priv_t * q = (priv_t *)(effp - effp->flow + i)->priv;
-      output(p, q->max);
-    }
+  fprintf(stderr, "\nMax level ");
+  output(p, max);
+  for (i = 0; i < n; ++i) {
+    chan_t * q = &p->chans[i];
+    output(p, q->max);
+  }
 
-    fprintf(stderr, "\nPk lev dB %10.2f", linear_to_dB(max(-min, max)));
-    for (i = 0; i < n; ++i) {
-      priv_t * q = (priv_t *)(effp - effp->flow + i)->priv;
-      fprintf(stderr, "%10.2f", linear_to_dB(max(-q->min, q->max)));
-    }
+  fprintf(stderr, "\nPk lev dB %10.2f", linear_to_dB(max(-min, max)));
+  for (i = 0; i < n; ++i) {
+    chan_t * q = &p->chans[i];
+    fprintf(stderr, "%10.2f", linear_to_dB(max(-q->min, q->max)));
+  }
 
-    fprintf(stderr, "\nRMS lev dB%10.2f", linear_to_dB(sqrt(sigma_x2 / num_samples)));
-    for (i = 0; i < n; ++i) {
-      priv_t * q = (priv_t *)(effp - effp->flow + i)->priv;
-      fprintf(stderr, "%10.2f", linear_to_dB(sqrt(q->sigma_x2 / q->num_samples)));
-    }
+  fprintf(stderr, "\nRMS lev dB%10.2f", linear_to_dB(sqrt(sigma_x2 / num_samples)));
+  for (i = 0; i < n; ++i) {
+    chan_t * q = &p->chans[i];
+    fprintf(stderr, "%10.2f", linear_to_dB(sqrt(q->sigma_x2 / p->num_samples)));
+  }
 
-    fprintf(stderr, "\nRMS Pk dB %10.2f", linear_to_dB(sqrt(max_sigma_x2)));
-    for (i = 0; i < n; ++i) {
-      priv_t * q = (priv_t *)(effp - effp->flow + i)->priv;
-      fprintf(stderr, "%10.2f", linear_to_dB(sqrt(q->max_sigma_x2)));
-    }
+  fprintf(stderr, "\nRMS Pk dB %10.2f", linear_to_dB(sqrt(max_sigma_x2)));
+  for (i = 0; i < n; ++i) {
+    chan_t * q = &p->chans[i];
+    fprintf(stderr, "%10.2f", linear_to_dB(sqrt(q->max_sigma_x2)));
+  }
 
-    fprintf(stderr, "\nRMS Tr dB ");
-    if (min_sigma_x2 != 1)
-      fprintf(stderr, "%10.2f", linear_to_dB(sqrt(min_sigma_x2)));
+  fprintf(stderr, "\nRMS Tr dB ");
+  if (min_sigma_x2 != 1)
+    fprintf(stderr, "%10.2f", linear_to_dB(sqrt(min_sigma_x2)));
+  else fprintf(stderr, "         -");
+  for (i = 0; i < n; ++i) {
+    chan_t * q = &p->chans[i];
+    if (q->min_sigma_x2 != 1)
+      fprintf(stderr, "%10.2f", linear_to_dB(sqrt(q->min_sigma_x2)));
     else fprintf(stderr, "         -");
-    for (i = 0; i < n; ++i) {
-      priv_t * q = (priv_t *)(effp - effp->flow + i)->priv;
-      if (q->min_sigma_x2 != 1)
-        fprintf(stderr, "%10.2f", linear_to_dB(sqrt(q->min_sigma_x2)));
-      else fprintf(stderr, "         -");
-    }
-
-    if (effp->flows > 1)
-      fprintf(stderr, "\nCrest factor       -");
-    else fprintf(stderr, "\nCrest factor %7.2f", sigma_x2 ? avg_peak / sqrt(sigma_x2 / num_samples) : 1);
-    for (i = 0; i < n; ++i) {
-      priv_t * q = (priv_t *)(effp - effp->flow + i)->priv;
-      fprintf(stderr, "%10.2f", q->sigma_x2? max(-q->min, q->max) / sqrt(q->sigma_x2 / q->num_samples) : 1);
-    }
+  }
 
-    fprintf(stderr, "\nFlat factor%9.2f", linear_to_dB((min_runs + max_runs) / (min_count + max_count)));
-    for (i = 0; i < n; ++i) {
-      priv_t * q = (priv_t *)(effp - effp->flow + i)->priv;
-      fprintf(stderr, " %9.2f", linear_to_dB((q->min_runs + q->max_runs) / (q->min_count + q->max_count)));
-    }
+  if (chans > 1)
+    fprintf(stderr, "\nCrest factor       -");
+  else fprintf(stderr, "\nCrest factor %7.2f", sigma_x2 ? avg_peak / sqrt(sigma_x2 / num_samples) : 1);
+  for (i = 0; i < n; ++i) {
+    chan_t * q = &p->chans[i];
+    fprintf(stderr, "%10.2f", q->sigma_x2? max(-q->min, q->max) / sqrt(q->sigma_x2 / p->num_samples) : 1);
+  }
 
-    fprintf(stderr, "\nPk count   %9s", lsx_sigfigs3((min_count + max_count) / effp->flows));
-    for (i = 0; i < n; ++i) {
-      priv_t * q = (priv_t *)(effp - effp->flow + i)->priv;
-      fprintf(stderr, " %9s", lsx_sigfigs3((double)(q->min_count + q->max_count)));
-    }
+  fprintf(stderr, "\nFlat factor%9.2f", linear_to_dB((min_runs + max_runs) / (min_count + max_count)));
+  for (i = 0; i < n; ++i) {
+    chan_t * q = &p->chans[i];
+    fprintf(stderr, " %9.2f", linear_to_dB((q->min_runs + q->max_runs) / (q->min_count + q->max_count)));
+  }
 
-    b1 = bit_depth(mask, min, max, &b2);
-    fprintf(stderr, "\nBit-depth      %2u/%-2u", b1, b2);
-    for (i = 0; i < n; ++i) {
-      priv_t * q = (priv_t *)(effp - effp->flow + i)->priv;
-      b1 = bit_depth(q->mask, q->min, q->max, &b2);
-      fprintf(stderr, "     %2u/%-2u", b1, b2);
-    }
+  fprintf(stderr, "\nPk count   %9s", lsx_sigfigs3((min_count + max_count) / chans));
+  for (i = 0; i < n; ++i) {
+    chan_t * q = &p->chans[i];
+    fprintf(stderr, " %9s", lsx_sigfigs3((double)(q->min_count + q->max_count)));
+  }
 
-    fprintf(stderr, "\nNum samples%9s", lsx_sigfigs3((double)p->num_samples));
-    fprintf(stderr, "\nLength s   %9.3f", p->num_samples / effp->in_signal.rate);
-    fprintf(stderr, "\nScale max ");
-    output(p, 1.);
-    fprintf(stderr, "\nWindow s   %9.3f", p->time_constant);
-    fprintf(stderr, "\n");
+  b1 = bit_depth(mask, min, max, &b2);
+  fprintf(stderr, "\nBit-depth      %2u/%-2u", b1, b2);
+  for (i = 0; i < n; ++i) {
+    chan_t * q = &p->chans[i];
+    b1 = bit_depth(q->mask, q->min, q->max, &b2);
+    fprintf(stderr, "     %2u/%-2u", b1, b2);
   }
+
+  fprintf(stderr, "\nNum samples%9s", lsx_sigfigs3((double)p->num_samples));
+  fprintf(stderr, "\nLength s   %9.3f", p->num_samples / effp->in_signal.rate);
+  fprintf(stderr, "\nScale max ");
+  output(p, 1.);
+  fprintf(stderr, "\nWindow s   %9.3f", p->time_constant);
+  fprintf(stderr, "\n");
+  free(p->chans);
   return SOX_SUCCESS;
 }
 
 sox_effect_handler_t const * lsx_stats_effect_fn(void)
 {
   static sox_effect_handler_t handler = {
-    "stats", "[-b bits|-x bits|-s scale] [-w window-time]", SOX_EFF_MODIFY,
+    "stats", "[-b bits|-x bits|-s scale] [-w window-time]", SOX_EFF_MCHAN | SOX_EFF_MODIFY,
     getopts, start, flow, drain, stop, NULL, sizeof(priv_t)};
   return &handler;
 }
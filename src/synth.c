@@ -159,6 +159,71 @@ static float GeneratePinkNoise(PinkNoise * pink)
 
 
 
+/******************************************************************************
+ * Band-limited wave-forms: square, sawtooth, triangle & trapezium are all
+ * piecewise linear, so their Fourier series are found exactly, segment by
+ * segment; from this, a table is made (as needed) for each octave of
+ * fundamental frequency, holding just the harmonics that fit below Nyquist.
+ * Between octaves, the next table up is faded in, so a sweep gains and loses
+ * harmonics smoothly; below the lowest octave, the exact wave-form is used.
+ */
+
+#define WAVE_TABLE_LEN    8192 /* Points in one cycle */
+#define WAVE_TABLE_LEVELS 11   /* Table k has 2^k harmonics */
+
+/* Add to coefs (re, im pairs, from the 0th harmonic) the Fourier series, to n
+ * harmonics, of a segment of wave-form that runs linearly from va at phase a
+ * to vb at phase b. */
+static void add_segment(double * coefs, size_t n,
+    double a, double b, double va, double vb)
+{
+  double s;
+  size_t k;
+
+  if (b <= a)
+    return;
+  s = (vb - va) / (b - a);
+  coefs[0] += (va + vb) * .5 * (b - a);
+  for (k = 1; k <= n; ++k) {
+    double w = 2 * M_PI * k;
+    double ca = cos(w * a), sa = sin(w * a), cb = cos(w * b), sb = sin(w * b);
+    coefs[2 * k    ] += (vb * sb - va * sa) / w + s * (cb - ca) / (w * w);
+    coefs[2 * k + 1] += (vb * cb - va * ca) / w - s * (sb - sa) / (w * w);
+  }
+}
+
+/* Cubic-interpolated look-up of phase [0, 1] in a table (which has a point
+ * of wrap-round before it and two after it): */
+static double wave_table_value(double const * t, double phase)
+{
+  double x = phase * WAVE_TABLE_LEN;
+  size_t i = (size_t)x;
+  double f = x - i, a, b, c;
+
+  t += i & (WAVE_TABLE_LEN - 1);
+  b = .5 * (t[1] + t[-1]) - t[0];
+  a = (1. / 6) * (t[2] - t[1] + t[-1] - t[0] - 4 * b);
+  c = t[1] - t[0] - a - b;
+  return ((a * f + b) * f + c) * f + t[0];
+}
+
+/* sin(2 pi phase), for phase [0, 1], by an odd polynomial in 2 pi phase that
+ * has been folded into [-pi/2, pi/2]; the error is < 1e-13. */
+static double sin_2pi(double phase)
+{
+  double x = phase - .5, y; /* sin(2 pi phase) = -sin(2 pi x) */
+
+  x = x < -.25? -.5 - x : x > .25? .5 - x : x;
+  x *= 2 * M_PI, y = x * x;
+  return -x * (1 + y * (-1. / 6 + y * (1. / 120 + y * (-1. / 5040 +
+      y * (1. / 362880 + y * (-1. / 39916800 + y * (1. / 6227020800. +
+      y * (-1. / 1307674368000. + y * (1. / 355687428096000.)))))))));
+}
+
+/**************** end of band-limited wave-form stuff */
+
+
+
 typedef enum {Linear, Square, Exp, Exp_cycle} sweep_t;
 
 typedef struct {
@@ -177,8 +242,14 @@ typedef struct {
 
   double * buffer;
   size_t buffer_len, pos;
+
+  double * sweep_tab;       /* Exp sweeps: the exp term for each of a block */
+  double * coefs;           /* Band-limited types: the Fourier series, */
+  double * tables[WAVE_TABLE_LEVELS]; /* and the tables made from it so far */
 } channel_t;
 
+#define BLOCK_LEN 1024      /* Samples generated for a channel at a time */
+
 
 
 /* Private data for the synthesizer */
@@ -192,6 +263,8 @@ typedef struct {
   size_t        number_of_channels;
   sox_bool      no_headroom;
   double        gain;
+  sox_bool      sample_at_a_time; /* If any channel is noise or pluck */
+  double        * block;    /* BLOCK_LEN samples for each channel */
 } priv_t;
 
 
@@ -413,6 +486,7 @@ static int start(sox_effect_t * effp)
   size_t i, j, k;
 
   p->samples_done = 0;
+  p->sample_at_a_time = sox_false;
 
   if (p->length_str)
     if (lsx_parsesamples(effp->in_signal.rate, p->length_str, &p->samples_to_do, 't') == NULL)
@@ -513,6 +587,41 @@ static int start(sox_effect_t * effp)
           (log(chan->freq2) - log(chan->freq)) / p->samples_to_do : 1;
         break;
     }
+    if (chan->sweep >= Exp) {
+      chan->sweep_tab = lsx_malloc(BLOCK_LEN * sizeof(*chan->sweep_tab));
+      for (j = 0; j < BLOCK_LEN; ++j)
+        chan->sweep_tab[j] = exp(chan->sweep == Exp?
+            chan->mult * j / effp->in_signal.rate : j * chan->mult);
+    }
+    if (chan->type >= synth_square && chan->type <= synth_trapezium) {
+      size_t n = 1 << (WAVE_TABLE_LEVELS - 1);
+      double * c = chan->coefs = lsx_calloc(2 * (n + 1), sizeof(*c));
+      double p1 = chan->p1, p2 = chan->p2, p3 = chan->p3;
+
+      switch (chan->type) { /* As drawn in make_tone, below: */
+        case synth_square:
+          add_segment(c, n, 0., p1, 1., 1.);
+          add_segment(c, n, p1, 1., -1., -1.);
+          break;
+        case synth_sawtooth:
+          add_segment(c, n, 0., 1., -1., 1.);
+          break;
+        case synth_triangle:
+          add_segment(c, n, 0., p1, -1., 1.);
+          add_segment(c, n, p1, 1., 1., -1.);
+          break;
+        default: { /* trapezium */
+          double a = max(p1, p2), b = max(a, p3);
+          add_segment(c, n, 0., p1, -1., 1.);
+          add_segment(c, n, p1, a, 1., 1.);
+          if (b > a)
+            add_segment(c, n, a, b,
+                1 - 2 * (a - p2) / (p3 - p2), 1 - 2 * (b - p2) / (p3 - p2));
+          add_segment(c, n, b, 1., -1., -1.);
+        }
+      }
+    }
+    p->sample_at_a_time |= chan->type >= synth_noise;
     lsx_debug("type=%s, combine=%s, samples_to_do=%lu, f1=%g, f2=%g, "
               "offset=%g, phase=%g, p1=%g, p2=%g, p3=%g mult=%g",
         lsx_find_enum_value(chan->type, synth_type)->text,
@@ -520,193 +629,315 @@ static int start(sox_effect_t * effp)
         (unsigned long)p->samples_to_do, chan->freq, chan->freq2,
         chan->offset, chan->phase, chan->p1, chan->p2, chan->p3, chan->mult);
   }
+  p->block = lsx_malloc(p->number_of_channels * BLOCK_LEN * sizeof(*p->block));
   p->gain = 1;
   effp->out_signal.mult = p->no_headroom? NULL : &p->gain;
   return SOX_SUCCESS;
 }
 
-#define elapsed_time_s p->samples_done / effp->in_signal.rate
+/* The instantaneous frequency of a sweep, n samples in: */
+static double sweep_freq(channel_t const * chan, double n, double rate)
+{
+  switch (chan->sweep) {
+    case Linear: return chan->freq + 2 * n * chan->mult;
+    case Square: return chan->freq + 3 * sign(chan->mult) * sqr(n * chan->mult);
+    case Exp:    return chan->freq * chan->mult * exp(chan->mult * n / rate);
+    default:     return chan->freq * exp(n * chan->mult);
+  }
+}
 
-static int flow(sox_effect_t * effp, const sox_sample_t * ibuf, sox_sample_t * obuf,
-    size_t * isamp, size_t * osamp)
+/* The octave, [0, WAVE_TABLE_LEVELS - 1], of a table's worth of harmonics that
+ * fit below Nyquist at the given frequency; fractional between tables: */
+static double wave_level(double freq, double rate)
 {
-  priv_t * p = (priv_t *) effp->priv;
-  unsigned len = min(*isamp, *osamp) / effp->in_signal.channels;
-  unsigned c, done;
-  int result = SOX_SUCCESS;
+  double level = freq > 0? log(rate / 2 / freq) / log(2.) : WAVE_TABLE_LEVELS;
+  return range_limit(level, 0, WAVE_TABLE_LEVELS - 1);
+}
 
-  for (done = 0; done < len && result == SOX_SUCCESS; ++done) {
-    for (c = 0; c < effp->in_signal.channels; c++) {
-      sox_sample_t synth_input = *ibuf++;
-      channel_t *  chan = &p->channels[c];
-      double synth_out;              /* [-1, 1] */
-
-      if (chan->type < synth_noise) { /* Need to calculate phase: */
-        double phase;            /* [0, 1) */
-        switch (chan->sweep) {
-          case Linear:
-            phase = (chan->freq + p->samples_done * chan->mult) *
-                elapsed_time_s;
-            break;
-          case Square:
-            phase = (chan->freq + sign(chan->mult) * 
-                sqr(p->samples_done * chan->mult)) * elapsed_time_s;
-            break;
-          case Exp:
-            phase = chan->freq * exp(chan->mult * elapsed_time_s);
-            break;
-          case Exp_cycle: default: {
-            double f = chan->freq * exp(p->samples_done * chan->mult);
-            double cycle_elapsed_time_s = elapsed_time_s - chan->cycle_start_time_s;
-            if (f * cycle_elapsed_time_s >= 1) {  /* move to next cycle */
-              chan->cycle_start_time_s += 1 / f;
-              cycle_elapsed_time_s = elapsed_time_s - chan->cycle_start_time_s;
-            }
-            phase = f * cycle_elapsed_time_s;
-            break;
-          }
-        }
-        phase = fmod(phase + chan->phase, 1.0);
-
-        switch (chan->type) {
-          case synth_sine:
-            synth_out = sin(2 * M_PI * phase);
-            break;
-
-          case synth_square:
-            /* |_______           | +1
-             * |       |          |
-             * |_______|__________|  0
-             * |       |          |
-             * |       |__________| -1
-             * |                  |
-             * 0       p1          1
-             */
-            synth_out = -1 + 2 * (phase < chan->p1);
-            break;
-
-          case synth_sawtooth:
-            /* |           __| +1
-             * |        __/  |
-             * |_______/_____|  0
-             * |  __/        |
-             * |_/           | -1
-             * |             |
-             * 0             1
-             */
-            synth_out = -1 + 2 * phase;
-            break;
-
-          case synth_triangle:
-            /* |    .    | +1
-             * |   / \   |
-             * |__/___\__|  0
-             * | /     \ |
-             * |/       \| -1
-             * |         |
-             * 0   p1    1
-             */
-
-            if (phase < chan->p1)
-              synth_out = -1 + 2 * phase / chan->p1;          /* In rising part of period */
-            else
-              synth_out = 1 - 2 * (phase - chan->p1) / (1 - chan->p1); /* In falling part */
-            break;
-
-          case synth_trapezium:
-            /* |    ______             |+1
-             * |   /      \            |
-             * |__/________\___________| 0
-             * | /          \          |
-             * |/            \_________|-1
-             * |                       |
-             * 0   p1    p2   p3       1
-             */
-            if (phase < chan->p1)       /* In rising part of period */
-              synth_out = -1 + 2 * phase / chan->p1;
-            else if (phase < chan->p2)  /* In high part of period */
-              synth_out = 1;
-            else if (phase < chan->p3)  /* In falling part */
-              synth_out = 1 - 2 * (phase - chan->p2) / (chan->p3 - chan->p2);
-            else                        /* In low part of period */
-              synth_out = -1;
-            break;
-
-          case synth_exp:
-            /* |             |              | +1
-             * |            | |             |
-             * |          _|   |_           | 0
-             * |       __-       -__        |
-             * |____---             ---____ | f(p2)
-             * |                            |
-             * 0             p1             1
-             */
-            synth_out = dB_to_linear(chan->p2 * -200);  /* 0 ..  1 */
-            if (phase < chan->p1)
-              synth_out = synth_out * exp(phase * log(1 / synth_out) / chan->p1);
-            else
-              synth_out = synth_out * exp((1 - phase) * log(1 / synth_out) / (1 - chan->p1));
-            synth_out = synth_out * 2 - 1;      /* map 0 .. 1 to -1 .. +1 */
-            break;
-
-          default: synth_out = 0;
-        }
-      } else switch (chan->type) {
-        case synth_whitenoise:
-          synth_out = DRANQD1;
-          break;
+/* The table of 2^level harmonics, made if need be: */
+static double const * wave_table(channel_t * chan, int level)
+{
+  if (!chan->tables[level]) {
+    size_t i, n = 1 << level;
+    double * t;
+
+    chan->tables[level] = lsx_calloc(WAVE_TABLE_LEN + 3, sizeof(*t));
+    t = chan->tables[level] + 1;
+    t[0] = 2 * chan->coefs[0];
+    for (i = 1; i <= n; ++i) {
+      t[2 * i] = 2 * chan->coefs[2 * i];
+      t[2 * i + 1] = -2 * chan->coefs[2 * i + 1];
+    }
+    lsx_safe_rdft(WAVE_TABLE_LEN, -1, t);
+    t[-1] = t[WAVE_TABLE_LEN - 1];
+    t[WAVE_TABLE_LEN] = t[0];
+    t[WAVE_TABLE_LEN + 1] = t[1];
+    lsx_debug("made table with %lu harmonics", (unsigned long)n);
+  }
+  return chan->tables[level] + 1;
+}
 
-        case synth_tpdfnoise:
-          synth_out = .5 * (DRANQD1 + DRANQD1);
-          break;
+/* The exact (not band-limited) wave-form at phase [0, 1): */
+static double wave_exact(channel_t const * chan, double phase)
+{
+  switch (chan->type) {
+    case synth_square: return -1 + 2 * (phase < chan->p1);
+    case synth_sawtooth: return -1 + 2 * phase;
+    case synth_triangle: return phase < chan->p1?
+      -1 + 2 * phase / chan->p1 : 1 - 2 * (phase - chan->p1) / (1 - chan->p1);
+    default:
+      if (phase < chan->p1)       /* trapezium */
+        return -1 + 2 * phase / chan->p1;
+      if (phase < chan->p2)
+        return 1;
+      if (phase < chan->p3)
+        return 1 - 2 * (phase - chan->p2) / (chan->p3 - chan->p2);
+      return -1;
+  }
+}
 
-        case synth_pinknoise:
-          synth_out = GeneratePinkNoise(&(chan->pink_noise));
-          break;
+/* Generate n samples [-1, 1] of a tone channel, from sample n0, in x: */
+static void make_tone(channel_t * chan, double rate, size_t n0, size_t n,
+    double * x)
+{
+  size_t i;
 
-        case synth_brownnoise:
-          do synth_out = chan->lp_last_out + DRANQD1 * (1. / 16);
-          while (fabs(synth_out) > 1);
-          chan->lp_last_out = synth_out;
-          break;
+  switch (chan->sweep) { /* Get the phase, in cycles: */
+    case Linear:
+      for (i = 0; i < n; ++i)
+        x[i] = (chan->freq + (n0 + i) * chan->mult) * (n0 + i) / rate;
+      break;
+    case Square:
+      for (i = 0; i < n; ++i)
+        x[i] = (chan->freq + sign(chan->mult) *
+            sqr((n0 + i) * chan->mult)) * (n0 + i) / rate;
+      break;
+    case Exp: {
+      double f = chan->freq * exp(chan->mult * n0 / rate);
+      for (i = 0; i < n; ++i)
+        x[i] = f * chan->sweep_tab[i];
+      break;
+    }
+    case Exp_cycle: default: {
+      double f0 = chan->freq * exp(n0 * chan->mult);
+      for (i = 0; i < n; ++i) {
+        double f = f0 * chan->sweep_tab[i];
+        double elapsed_time_s = (n0 + i) / rate;
+        double cycle_elapsed_time_s = elapsed_time_s - chan->cycle_start_time_s;
+        if (f * cycle_elapsed_time_s >= 1) {  /* move to next cycle */
+          chan->cycle_start_time_s += 1 / f;
+          cycle_elapsed_time_s = elapsed_time_s - chan->cycle_start_time_s;
+        }
+        x[i] = f * cycle_elapsed_time_s;
+      }
+      break;
+    }
+  }
+  for (i = 0; i < n; ++i) {   /* [0, 1) */
+    x[i] += chan->phase;
+    x[i] -= floor(x[i]);
+  }
 
-        case synth_pluck: {
-          double d = chan->buffer[chan->pos];
+  switch (chan->type) {
+    case synth_sine:
+      for (i = 0; i < n; ++i)
+        x[i] = sin_2pi(x[i]);
+      break;
 
-          chan->hp_last_out = 
-             (d - chan->hp_last_in) * chan->c3 + chan->hp_last_out * chan->c2;
-          chan->hp_last_in = d;
-        
-          synth_out = range_limit(chan->hp_last_out, -1, 1);
+    case synth_square:
+      /* |_______           | +1
+       * |       |          |
+       * |_______|__________|  0
+       * |       |          |
+       * |       |__________| -1
+       * |                  |
+       * 0       p1          1
+       */
 
-          chan->lp_last_out = d = d * chan->c1 + chan->lp_last_out * chan->c0;
+    case synth_sawtooth:
+      /* |           __| +1
+       * |        __/  |
+       * |_______/_____|  0
+       * |  __/        |
+       * |_/           | -1
+       * |             |
+       * 0             1
+       */
 
-          chan->ap_last_out = chan->buffer[chan->pos] =
-            (d - chan->ap_last_out) * chan->c4 + chan->ap_last_in;
-          chan->ap_last_in = d;
+    case synth_triangle:
+      /* |    .    | +1
+       * |   / \   |
+       * |__/___\__|  0
+       * | /     \ |
+       * |/       \| -1
+       * |         |
+       * 0   p1    1
+       */
 
-          chan->pos = chan->pos + 1 == chan->buffer_len? 0 : chan->pos + 1;
-          break;
+    case synth_trapezium: {
+      /* |    ______             |+1
+       * |   /      \            |
+       * |__/________\___________| 0
+       * | /          \          |
+       * |/            \_________|-1
+       * |                       |
+       * 0   p1    p2   p3       1
+       */
+      double l0 = wave_level(sweep_freq(chan, (double)n0, rate), rate);
+      double l1 = wave_level(sweep_freq(chan, (double)(n0 + n), rate), rate);
+
+      if (l0 == WAVE_TABLE_LEVELS - 1 && l1 == WAVE_TABLE_LEVELS - 1) {
+        for (i = 0; i < n; ++i)   /* All harmonics fit: */
+          x[i] = wave_exact(chan, x[i]);
+        break;
+      }
+      for (i = 0; i < n; ++i) { /* The level is interpolated across the block */
+        double level = l0 + (l1 - l0) * i / n, y;
+        int k = (int)level;
+
+        if (k == WAVE_TABLE_LEVELS - 1) {
+          x[i] = wave_exact(chan, x[i]);
+          continue;
         }
+        y = wave_table_value(wave_table(chan, k), x[i]);
+        if (level > k)
+          y += (level - k) * (wave_table_value(wave_table(chan, k + 1), x[i]) - y);
+        x[i] = range_limit(y, -1, 1); /* Clip any Gibbs overshoot */
+      }
+      break;
+    }
 
-        default: synth_out = 0;
+    case synth_exp:
+      /* |             |              | +1
+       * |            | |             |
+       * |          _|   |_           | 0
+       * |       __-       -__        |
+       * |____---             ---____ | f(p2)
+       * |                            |
+       * 0             p1             1
+       */
+      for (i = 0; i < n; ++i) {
+        double phase = x[i];
+        double synth_out = dB_to_linear(chan->p2 * -200);  /* 0 ..  1 */
+        if (phase < chan->p1)
+          synth_out = synth_out * exp(phase * log(1 / synth_out) / chan->p1);
+        else
+          synth_out = synth_out * exp((1 - phase) * log(1 / synth_out) / (1 - chan->p1));
+        x[i] = synth_out * 2 - 1;      /* map 0 .. 1 to -1 .. +1 */
       }
+      break;
+
+    default: memset(x, 0, n * sizeof(*x));
+  }
+}
+
+/* Generate one sample [-1, 1] of a noise or pluck channel: */
+static double make_sample(channel_t * chan)
+{
+  double synth_out;
 
-      /* Add offset, but prevent clipping: */
-      synth_out = synth_out * (1 - fabs(chan->offset)) + chan->offset;
+  switch (chan->type) {
+    case synth_whitenoise:
+      synth_out = DRANQD1;
+      break;
+
+    case synth_tpdfnoise:
+      synth_out = .5 * (DRANQD1 + DRANQD1);
+      break;
+
+    case synth_pinknoise:
+      synth_out = GeneratePinkNoise(&(chan->pink_noise));
+      break;
+
+    case synth_brownnoise:
+      do synth_out = chan->lp_last_out + DRANQD1 * (1. / 16);
+      while (fabs(synth_out) > 1);
+      chan->lp_last_out = synth_out;
+      break;
+
+    case synth_pluck: {
+      double d = chan->buffer[chan->pos];
+
+      chan->hp_last_out = 
+         (d - chan->hp_last_in) * chan->c3 + chan->hp_last_out * chan->c2;
+      chan->hp_last_in = d;
+    
+      synth_out = range_limit(chan->hp_last_out, -1, 1);
+
+      chan->lp_last_out = d = d * chan->c1 + chan->lp_last_out * chan->c0;
+
+      chan->ap_last_out = chan->buffer[chan->pos] =
+        (d - chan->ap_last_out) * chan->c4 + chan->ap_last_in;
+      chan->ap_last_in = d;
+
+      chan->pos = chan->pos + 1 == chan->buffer_len? 0 : chan->pos + 1;
+      break;
+    }
+
+    default: synth_out = 0;
+  }
+  return synth_out;
+}
+
+static int flow(sox_effect_t * effp, const sox_sample_t * ibuf, sox_sample_t * obuf,
+    size_t * isamp, size_t * osamp)
+{
+  priv_t * p = (priv_t *) effp->priv;
+  size_t chans = effp->in_signal.channels;
+  size_t len = min(*isamp, *osamp) / chans;
+  size_t c, i, n, done;
+  int result = SOX_SUCCESS;
+
+  for (done = 0; done < len && result == SOX_SUCCESS; done += n) {
+    n = min(len - done, BLOCK_LEN);
+    if (p->samples_to_do)
+      n = min(n, p->samples_to_do - p->samples_done);
+
+    /* Tones are made a channel at a time; the others a sample at a time
+     * across the channels (so noise draws on the one random sequence in the
+     * same order as ever): */
+    for (c = 0; c < chans; ++c)
+      if (p->channels[c].type < synth_noise)
+        make_tone(&p->channels[c], effp->in_signal.rate, p->samples_done, n,
+            p->block + c * BLOCK_LEN);
+    if (p->sample_at_a_time)
+      for (i = 0; i < n; ++i)
+        for (c = 0; c < chans; ++c)
+          if (p->channels[c].type >= synth_noise)
+            p->block[c * BLOCK_LEN + i] = make_sample(&p->channels[c]);
+
+    for (c = 0; c < chans; ++c) {
+      channel_t * chan = &p->channels[c];
+      double * x = p->block + c * BLOCK_LEN;
+      sox_sample_t const * in = ibuf + c;
+      sox_sample_t * out = obuf + c;
+
+      for (i = 0; i < n; ++i)  /* Add offset, but prevent clipping: */
+        x[i] = x[i] * (1 - fabs(chan->offset)) + chan->offset;
 
       switch (chan->combine) {
-        case synth_create: synth_out *=  SOX_SAMPLE_MAX; break;
-        case synth_mix   : synth_out = (synth_out * SOX_SAMPLE_MAX + synth_input) * .5; break;
-        case synth_amod  : synth_out = (synth_out + 1) * synth_input * .5; break;
-        case synth_fmod  : synth_out *=  synth_input; break;
+        case synth_create:
+          for (i = 0; i < n; ++i) x[i] *= SOX_SAMPLE_MAX;
+          break;
+        case synth_mix:
+          for (i = 0; i < n; ++i) x[i] = (x[i] * SOX_SAMPLE_MAX + in[i * chans]) * .5;
+          break;
+        case synth_amod:
+          for (i = 0; i < n; ++i) x[i] = (x[i] + 1) * in[i * chans] * .5;
+          break;
+        case synth_fmod:
+          for (i = 0; i < n; ++i) x[i] *= in[i * chans];
+          break;
       }
-      *obuf++ = synth_out < 0? synth_out * p->gain - .5 : synth_out * p->gain + .5;
+      for (i = 0; i < n; ++i)
+        out[i * chans] = x[i] < 0? x[i] * p->gain - .5 : x[i] * p->gain + .5;
     }
-    if (++p->samples_done == p->samples_to_do)
+    ibuf += n * chans;
+    obuf += n * chans;
+    if ((p->samples_done += n) == p->samples_to_do)
       result = SOX_EOF;
   }
-  *isamp = *osamp = done * effp->in_signal.channels;
+  *isamp = *osamp = done * chans;
   return result;
 }
 
@@ -716,10 +947,18 @@ static int stop(sox_effect_t * effp)
 {
   priv_t * p = (priv_t *) effp->priv;
   size_t i;
+  int j;
 
-  for (i = 0; i < p->number_of_channels; ++i)
-    free(p->channels[i].buffer);
+  for (i = 0; i < p->number_of_channels; ++i) {
+    channel_t * chan = &p->channels[i];
+    free(chan->buffer);
+    free(chan->sweep_tab);
+    free(chan->coefs);
+    for (j = 0; j < WAVE_TABLE_LEVELS; ++j)
+      free(chan->tables[j]);
+  }
   free(p->channels);
+  free(p->block);
   return SOX_SUCCESS;
 }
 
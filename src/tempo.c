@@ -37,6 +37,8 @@ typedef struct {
   fifo_t input_fifo;
   float * overlap_buf;
   fifo_t output_fifo;
+  int dft_len;           /* If not 0, linear search is done by DFT */
+  double * dft_buf;
 
   /* Counters: */
   size_t samples_in;
@@ -48,13 +50,40 @@ typedef struct {
 /* Waveform Similarity by least squares; works across multi-channels */
 static float difference(const float * a, const float * b, size_t length)
 {
-  float diff = 0;
-  size_t i = 0;
+  float diff[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+  size_t i, j;
+
+  for (i = 0; i < length; i += 8)    /* N.B. length ≡ 0 (mod 8) */
+    for (j = 0; j < 8; ++j)          /* 8 partial sums; vectorisable */
+      diff[j] += sqr(a[i + j] - b[i + j]);
+  return ((diff[0] + diff[4]) + (diff[2] + diff[6])) +
+         ((diff[1] + diff[5]) + (diff[3] + diff[7]));
+}
+
+typedef struct {tempo_t * t; float const * new_win;} dft_search_t;
 
-  #define _ diff += sqr(a[i] - b[i]), ++i; /* Loop optimisation */
-  do {_ _ _ _ _ _ _ _} while (i < length); /* N.B. length ≡ 0 (mod 8) */
-  #undef _
-  return diff;
+static double dft_difference(void * data, size_t i)
+{
+  dft_search_t * s = (dft_search_t *)data;
+  return difference(s->new_win + s->t->channels * i, s->t->overlap_buf,
+      s->t->channels * s->t->overlap);
+}
+
+/* Linear search by DFT cross-correlation; see lsx_best_overlap_dft. */
+static size_t tempo_best_overlap_dft(tempo_t * t, float const * new_win)
+{
+  size_t i, n = t->channels * t->overlap;
+  size_t len = t->channels * (t->search - 1) + n;
+  double * x = t->dft_buf, * y = x + t->dft_len + t->search;
+  dft_search_t s;
+
+  for (i = 0; i < len; ++i)
+    x[i] = new_win[i];
+  for (i = 0; i < n; ++i)
+    y[i] = t->overlap_buf[i];
+  s.t = t, s.new_win = new_win;
+  return lsx_best_overlap_dft(t->dft_len, x, y, n, t->search, t->channels,
+      dft_difference, &s);
 }
 
 /* Find where the two segments are most alike over the overlap period. */
@@ -63,9 +92,13 @@ static size_t tempo_best_overlap_position(tempo_t * t, float const * new_win)
   float * f = t->overlap_buf;
   size_t j, best_pos, prev_best_pos = (t->search + 1) >> 1, step = 64;
   size_t i = best_pos = t->quick_search? prev_best_pos : 0;
-  float diff, least_diff = difference(new_win + t->channels * i, f, t->channels * t->overlap);
+  float diff, least_diff;
   int k = 0;
 
+  if (t->dft_len)
+    return tempo_best_overlap_dft(t, new_win);
+  least_diff = difference(new_win + t->channels * i, f, t->channels * t->overlap);
+
   if (t->quick_search) do { /* hierarchical search */
     for (k = -1; k <= 1; k += 2) for (j = 1; j < 4 || step == 64; ++j) {
       i = prev_best_pos + k * j * step;
@@ -85,20 +118,30 @@ static size_t tempo_best_overlap_position(tempo_t * t, float const * new_win)
   return best_pos;
 }
 
-static void tempo_overlap(
-    tempo_t * t, const float * in1, const float * in2, float * output)
+static void overlap(size_t channels, size_t length,
+    const float * in1, const float * in2, float * output)
 {
   size_t i, j, k = 0;
-  float fade_step = 1.0f / (float) t->overlap;
+  float fade_step = 1.0f / (float) length;
 
-  for (i = 0; i < t->overlap; ++i) {
+  for (i = 0; i < length; ++i) {
     float fade_in  = fade_step * (float) i;
     float fade_out = 1.0f - fade_in;
-    for (j = 0; j < t->channels; ++j, ++k)
+    for (j = 0; j < channels; ++j, ++k)
       output[k] = in1[k] * fade_out + in2[k] * fade_in;
   }
 }
 
+static void tempo_overlap(
+    tempo_t * t, const float * in1, const float * in2, float * output)
+{ /* Constant channel counts let the compiler vectorise the common cases: */
+  if (t->channels == 1)
+    overlap((size_t)1, t->overlap, in1, in2, output);
+  else if (t->channels == 2)
+    overlap((size_t)2, t->overlap, in1, in2, output);
+  else overlap(t->channels, t->overlap, in1, in2, output);
+}
+
 static void tempo_process(tempo_t * t)
 {
   while (fifo_occupancy(&t->input_fifo) >= t->process_size) {
@@ -177,6 +220,9 @@ static void tempo_setup(tempo_t * t,
   if (t->overlap * 2 > t->segment)
     t->overlap -= 8;
   t->overlap_buf = lsx_malloc(t->overlap * t->channels * sizeof(*t->overlap_buf));
+  if (!quick_search && (t->dft_len = lsx_overlap_dft_len(
+          t->channels * t->overlap, t->search, t->channels)))
+    t->dft_buf = lsx_malloc((2 * t->dft_len + t->search) * sizeof(*t->dft_buf));
   max_skip = ceil(factor * (t->segment - t->overlap));
   t->process_size = max(max_skip + t->overlap, t->segment) + t->search;
   memset(fifo_reserve(&t->input_fifo, t->search / 2), 0, (t->search / 2) * t->channels * sizeof(float));
@@ -184,6 +230,7 @@ static void tempo_setup(tempo_t * t,
 
 static void tempo_delete(tempo_t * t)
 {
+  free(t->dft_buf);
   free(t->overlap_buf);
   fifo_delete(&t->output_fifo);
   fifo_delete(&t->input_fifo);
@@ -17,10 +17,12 @@
 
 #include "sox_i.h"
 #include "sgetopt.h"
+#include "fft4g.h"
 #include <string.h>
 
 typedef struct {
   double    * dftBuf, * noiseSpectrum, * spectrum, * measures, meanMeas;
+  double    * cepstrumBuf, meas;
 } chan_t;
 
 typedef struct {                /* Configuration parameters: */
@@ -39,6 +41,8 @@ typedef struct {                /* Configuration parameters: */
   double    measureTcMult, triggerMeasTcMult;
   double    * spectrumWindow, * cepstrumWindow;
   chan_t    * channels;
+  int       * dftBr;            /* DFT tables, private so that channels can */
+  double    * dftSc;            /* be measured in parallel */
 } priv_t;
 
 #define GETOPT_FREQ(c, name, min) \
@@ -122,6 +126,7 @@ static int start(sox_effect_t * effp)
   for (i = 0; i < effp->in_signal.channels; ++i) {
     chan_t * c = &p->channels[i];
     lsx_Calloc(c->dftBuf, p->dftLen_ws);
+    lsx_Calloc(c->cepstrumBuf, p->dftLen_ws >> 1);
     lsx_Calloc(c->spectrum, p->dftLen_ws);
     lsx_Calloc(c->noiseSpectrum, p->dftLen_ws);
     lsx_Calloc(c->measures, p->measuresLen);
@@ -148,6 +153,10 @@ static int start(sox_effect_t * effp)
   if (p->cepstrumEnd <= p->cepstrumStart)
     return SOX_EOF;
 
+  lsx_Calloc(p->dftBr, dft_br_len(p->dftLen_ws));
+  lsx_Calloc(p->dftSc, dft_sc_len(p->dftLen_ws));
+  lsx_rdft((int)p->dftLen_ws, 1, p->channels[0].dftBuf, p->dftBr, p->dftSc);
+
   p->noiseTcUpMult     = exp(-1 / (p->noiseTcUp   * p->measureFreq));
   p->noiseTcDownMult   = exp(-1 / (p->noiseTcDown * p->measureFreq));
   p->measureTcMult     = exp(-1 / (p->measureTc   * p->measureFreq));
@@ -184,31 +193,38 @@ static int flowFlush(sox_effect_t * effp, sox_sample_t const * ibuf,
 static double measure(
     priv_t * p, chan_t * c, size_t index_ns, unsigned step_ns, int bootCount)
 {
-  double mult, result = 0;
+  double mult, noiseMult, result = 0, * cepstrum = c->cepstrumBuf;
   size_t i;
 
-  for (i = 0; i < p->measureLen_ws; ++i, index_ns = (index_ns + step_ns) % p->samplesLen_ns)
+  for (i = 0; i < p->measureLen_ws; ++i) {
     c->dftBuf[i] = p->samples[index_ns] * p->spectrumWindow[i];
+    if ((index_ns += step_ns) >= p->samplesLen_ns)
+      index_ns -= p->samplesLen_ns;
+  }
   memset(c->dftBuf + i, 0, (p->dftLen_ws - i) * sizeof(*c->dftBuf));
-  lsx_safe_rdft((int)p->dftLen_ws, 1, c->dftBuf);
-
-  memset(c->dftBuf, 0, p->spectrumStart * sizeof(*c->dftBuf));
+  lsx_rdft((int)p->dftLen_ws, 1, c->dftBuf, p->dftBr, p->dftSc);
+
+  /* The spectral updates are independent per bin, so with the (constant)
+   * multipliers chosen up-front, and output to a separate buffer, the
+   * compiler can vectorise them: */
+  mult = bootCount >= 0? bootCount / (1. + bootCount) : p->measureTcMult;
+  noiseMult = bootCount >= 0? 0 : p->noiseTcDownMult;
+  memset(cepstrum, 0, p->spectrumStart * sizeof(*cepstrum));
   for (i = p->spectrumStart; i < p->spectrumEnd; ++i) {
     double d = sqrt(sqr(c->dftBuf[2 * i]) + sqr(c->dftBuf[2 * i + 1]));
-    mult = bootCount >= 0? bootCount / (1. + bootCount) : p->measureTcMult;
+    double m;
     c->spectrum[i] = c->spectrum[i] * mult + d * (1 - mult);
     d = sqr(c->spectrum[i]);
-    mult = bootCount >= 0? 0 :
-        d > c->noiseSpectrum[i]? p->noiseTcUpMult : p->noiseTcDownMult;
-    c->noiseSpectrum[i] = c->noiseSpectrum[i] * mult + d * (1 - mult);
+    m = bootCount < 0 && d > c->noiseSpectrum[i]? p->noiseTcUpMult : noiseMult;
+    c->noiseSpectrum[i] = c->noiseSpectrum[i] * m + d * (1 - m);
     d = sqrt(max(0, d - p->noiseReductionAmount * c->noiseSpectrum[i]));
-    c->dftBuf[i] = d * p->cepstrumWindow[i - p->spectrumStart];
+    cepstrum[i] = d * p->cepstrumWindow[i - p->spectrumStart];
   }
-  memset(c->dftBuf + i, 0, ((p->dftLen_ws >> 1) - i) * sizeof(*c->dftBuf));
-  lsx_safe_rdft((int)p->dftLen_ws >> 1, 1, c->dftBuf);
+  memset(cepstrum + i, 0, ((p->dftLen_ws >> 1) - i) * sizeof(*cepstrum));
+  lsx_rdft((int)p->dftLen_ws >> 1, 1, cepstrum, p->dftBr, p->dftSc);
 
   for (i = p->cepstrumStart; i < p->cepstrumEnd; ++i)
-    result += sqr(c->dftBuf[2 * i]) + sqr(c->dftBuf[2 * i + 1]);
+    result += sqr(cepstrum[2 * i]) + sqr(cepstrum[2 * i + 1]);
   result = log(result / (p->cepstrumEnd - p->cepstrumStart));
   return max(0, 21 + result);
 }
@@ -219,43 +235,56 @@ static int flowTrigger(sox_effect_t * effp, sox_sample_t const * ibuf,
   priv_t * p = (priv_t *)effp->priv;
   sox_bool hasTriggered = sox_false;
   size_t i, idone = 0, numMeasuresToFlush = 0;
+  int ch, chans = (int)effp->in_signal.channels;
 
   while (idone < *ilen && !hasTriggered) {
-    p->measureTimer_ns -= effp->in_signal.channels;
-    for (i = 0; i < effp->in_signal.channels; ++i, ++idone) {
+    size_t len = min(*ilen - idone, p->measureTimer_ns);
+    size_t len1 = min(len, p->samplesLen_ns - p->samplesIndex_ns);
+
+    /* Store samples up to the next measurement (or end of input): */
+    memcpy(p->samples + p->samplesIndex_ns, ibuf, len1 * sizeof(*ibuf));
+    memcpy(p->samples, ibuf + len1, (len - len1) * sizeof(*ibuf));
+    p->samplesIndex_ns = (p->samplesIndex_ns + len) % p->samplesLen_ns;
+    ibuf += len, idone += len;
+    if ((p->measureTimer_ns -= len))
+      break;
+
+    /* All channels' samples for the measurement are in place, so the
+     * channels can be measured together: */
+#ifdef HAVE_OPENMP
+    #pragma omp parallel for if (chans > 1)
+#endif
+    for (ch = 0; ch < chans; ++ch) {
+      size_t x = (p->samplesIndex_ns + p->samplesLen_ns + ch + 1 - chans - p->measureLen_ns) % p->samplesLen_ns;
+      p->channels[ch].meas = measure(p, &p->channels[ch], x, (unsigned)chans, p->bootCount);
+    }
+
+    for (i = 0; i < effp->in_signal.channels; ++i) {
       chan_t * c = &p->channels[i];
-      p->samples[p->samplesIndex_ns++] = *ibuf++;
-      if (!p->measureTimer_ns) {
-        size_t x = (p->samplesIndex_ns + p->samplesLen_ns - p->measureLen_ns) % p->samplesLen_ns;
-        double meas = measure(p, c, x, effp->in_signal.channels, p->bootCount);
-        c->measures[p->measuresIndex] = meas;
-        c->meanMeas = c->meanMeas * p->triggerMeasTcMult +
-            meas *(1 - p->triggerMeasTcMult);
-
-        if (hasTriggered |= c->meanMeas >= p->triggerLevel) {
-          unsigned n = p->measuresLen, k = p->measuresIndex;
-          unsigned j, jTrigger = n, jZero = n;
-          for (j = 0; j < n; ++j, k = (k + n - 1) % n)
-            if (c->measures[k] >= p->triggerLevel && j <= jTrigger + p->gapLen)
-              jZero = jTrigger = j;
-            else if (!c->measures[k] && jTrigger >= jZero)
-              jZero = j;
-          j = min(j, jZero);
-          numMeasuresToFlush = range_limit(j, numMeasuresToFlush, n);
-        }
-        lsx_debug_more("%12g %12g %u",
-            meas, c->meanMeas, (unsigned)numMeasuresToFlush);
+      double meas = c->meas;
+      c->measures[p->measuresIndex] = meas;
+      c->meanMeas = c->meanMeas * p->triggerMeasTcMult +
+          meas *(1 - p->triggerMeasTcMult);
+
+      if (hasTriggered |= c->meanMeas >= p->triggerLevel) {
+        unsigned n = p->measuresLen, k = p->measuresIndex;
+        unsigned j, jTrigger = n, jZero = n;
+        for (j = 0; j < n; ++j, k = (k + n - 1) % n)
+          if (c->measures[k] >= p->triggerLevel && j <= jTrigger + p->gapLen)
+            jZero = jTrigger = j;
+          else if (!c->measures[k] && jTrigger >= jZero)
+            jZero = j;
+        j = min(j, jZero);
+        numMeasuresToFlush = range_limit(j, numMeasuresToFlush, n);
       }
+      lsx_debug_more("%12g %12g %u",
+          meas, c->meanMeas, (unsigned)numMeasuresToFlush);
     }
-    if (p->samplesIndex_ns == p->samplesLen_ns)
-      p->samplesIndex_ns = 0;
-    if (!p->measureTimer_ns) {
-      p->measureTimer_ns = p->measurePeriod_ns;
-      ++p->measuresIndex;
-      p->measuresIndex %= p->measuresLen;
-      if (p->bootCount >= 0)
-        p->bootCount = p->bootCount == p->bootCountMax? -1 : p->bootCount + 1;
-    }
+    p->measureTimer_ns = p->measurePeriod_ns;
+    ++p->measuresIndex;
+    p->measuresIndex %= p->measuresLen;
+    if (p->bootCount >= 0)
+      p->bootCount = p->bootCount == p->bootCountMax? -1 : p->bootCount + 1;
   }
   if (hasTriggered) {
     size_t ilen1 = *ilen - idone;
@@ -285,8 +314,11 @@ static int stop(sox_effect_t * effp)
     free(c->measures);
     free(c->noiseSpectrum);
     free(c->spectrum);
+    free(c->cepstrumBuf);
     free(c->dftBuf);
   }
+  free(p->dftSc);
+  free(p->dftBr);
   free(p->channels);
   free(p->cepstrumWindow);
   free(p->spectrumWindow);
@@ -1623,7 +1623,7 @@ static int seek(sox_format_t * ft, uint64_t offset)
     off_t to = to_d;
     ft->sox_errno = (to != to_d)? SOX_EOF : lsx_seeki(ft, (off_t)wav->dataStart + (off_t)to, SEEK_SET);
     if (ft->sox_errno == SOX_SUCCESS)
-      wav->numSamples -= (size_t)wide_sample / ft->signal.channels;
+      wav->numSamples = (ft->signal.length - (size_t)wide_sample) / ft->signal.channels;
   }
 
   return ft->sox_errno;